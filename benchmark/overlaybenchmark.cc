@@ -0,0 +1,247 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+
+// Overlay rendering benchmark: renders the overlay window (qml/main.qml) with the 'offscreen'
+// platform and the software scene graph backend (unless set otherwise via QT_QPA_PLATFORM and
+// QT_QUICK_BACKEND), moves the spot along a scripted cursor path for every combination of spot
+// shape, zoom, border and rotation and prints frame time percentiles for each of them.
+//
+// Frame times are the sum of scene graph synchronization, rendering and swap of a frame, as
+// collected by FrameTiming for the overlay windows of the application.
+
+#include "frametiming.h"
+#include "spotcontroller.h"
+
+#include <QColor>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQmlPropertyMap>
+#include <QQuickWindow>
+#include <QTextStream>
+#include <QTimer>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace {
+  // -----------------------------------------------------------------------------------------------
+  struct Configuration
+  {
+    QString shape; // as in Settings.spotShape
+    bool zoom = false;
+    bool border = false;
+    qreal rotation = 0.0;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  // Settings properties used by main.qml with the application defaults.
+  void initSettings(QQmlPropertyMap& settings, QQmlPropertyMap& shapes)
+  {
+    auto square = new QQmlPropertyMap(&shapes);
+    square->insert("radius", 20);
+    auto star = new QQmlPropertyMap(&shapes);
+    star->insert("points", 5);
+    star->insert("innerRadius", 50);
+    auto ngon = new QQmlPropertyMap(&shapes);
+    ngon->insert("sides", 3);
+    shapes.insert("Square", QVariant::fromValue<QObject*>(square));
+    shapes.insert("Star", QVariant::fromValue<QObject*>(star));
+    shapes.insert("Ngon", QVariant::fromValue<QObject*>(ngon));
+
+    settings.insert("shapes", QVariant::fromValue<QObject*>(&shapes));
+    settings.insert("spotSize", 32);
+    settings.insert("spotShape", QStringLiteral("spotshapes/Circle.qml"));
+    settings.insert("spotRotationAllowed", false);
+    settings.insert("spotRotation", 0.0);
+    settings.insert("cursor", static_cast<int>(Qt::BlankCursor));
+    settings.insert("showSpotShade", true);
+    settings.insert("shadeColor", QColor("#222222"));
+    settings.insert("shadeOpacity", 0.3);
+    settings.insert("showBorder", false);
+    settings.insert("borderColor", QColor("#73d216"));
+    settings.insert("borderOpacity", 0.8);
+    settings.insert("borderSize", 4);
+    settings.insert("showCenterDot", true);
+    settings.insert("dotColor", QColor(Qt::red));
+    settings.insert("dotOpacity", 0.8);
+    settings.insert("dotSize", 5);
+    settings.insert("zoomEnabled", false);
+    settings.insert("zoomFactor", 2.0);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  void applyConfiguration(QQmlPropertyMap& settings, const Configuration& c)
+  {
+    // Inserting a changed value updates the QML bindings.
+    settings.insert("spotShape", c.shape);
+    settings.insert("zoomEnabled", c.zoom);
+    settings.insert("showBorder", c.border);
+    settings.insert("spotRotationAllowed", !qFuzzyIsNull(c.rotation));
+    settings.insert("spotRotation", c.rotation);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  // Desktop replacement for the zoom, with enough detail to make texture sampling realistic.
+  QImage desktopImage(const QSize& size)
+  {
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor("#3465a4"));
+    QPainter p(&image);
+    p.setPen(Qt::white);
+    for (int y = 0; y < size.height(); y += 24)
+    {
+      for (int x = 0; x < size.width(); x += 24)
+      {
+        p.fillRect(x, y, 12, 12, QColor::fromHsv((x + y) % 360, 160, 220));
+        if ((x / 24 + y / 24) % 8 == 0) { p.drawText(x, y + 22, QStringLiteral("Aa")); }
+      }
+    }
+    return image;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  // Lissajous path over most of the window, with varying speed.
+  QPointF cursorPosition(const QSize& size, int frame, int frames)
+  {
+    const qreal t = 2 * M_PI * frame / frames;
+    return QPointF(size.width() * (0.5 + 0.4 * std::sin(3 * t)),
+                   size.height() * (0.5 + 0.4 * std::sin(2 * t + M_PI / 4)));
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  bool waitForFrame(QQuickWindow* window, int timeoutMs = 2000)
+  {
+    QEventLoop loop;
+    bool swapped = false;
+    // Queued, frameSwapped() is emitted on the render thread with the threaded render loop.
+    const auto connection = QObject::connect(window, &QQuickWindow::frameSwapped, &loop,
+                                             [&loop, &swapped](){ swapped = true; loop.quit(); },
+                                             Qt::QueuedConnection);
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+    loop.exec();
+    QObject::disconnect(connection);
+    return swapped;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QString ms(qint64 us) {
+    return QString::number(us / 1000.0, 'f', 2);
+  }
+} // end anonymous namespace
+
+// -------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) { qputenv("QT_QPA_PLATFORM", "offscreen"); }
+  if (qEnvironmentVariableIsEmpty("QT_QUICK_BACKEND")) { qputenv("QT_QUICK_BACKEND", "software"); }
+
+  QGuiApplication app(argc, argv);
+  QTextStream out(stdout);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Projecteur overlay rendering benchmark.");
+  parser.addHelpOption();
+  const QCommandLineOption framesOption({"n", "frames"}, "Measured frames per configuration.", "frames", "300");
+  const QCommandLineOption sizeOption({"s", "size"}, "Overlay window size.", "WxH", "1920x1080");
+  parser.addOptions({framesOption, sizeOption});
+  parser.process(app);
+
+  const int frames = std::max(10, parser.value(framesOption).toInt());
+  const QStringList sizeValues = parser.value(sizeOption).split('x');
+  const QSize windowSize = (sizeValues.size() == 2)
+                           ? QSize(sizeValues[0].toInt(), sizeValues[1].toInt()) : QSize();
+  if (windowSize.isEmpty())
+  {
+    QTextStream(stderr) << "Invalid window size: " << parser.value(sizeOption) << '\n';
+    return 1;
+  }
+
+  QQmlPropertyMap settings;
+  QQmlPropertyMap shapes;
+  initSettings(settings, shapes);
+  // The spot is always on the benchmark window, see spotOnCurrentWindow in main.qml
+  QQmlPropertyMap projecteurApp;
+  projecteurApp.insert("currentSpotScreen", 1);
+  SpotController spotController;
+
+  QQmlEngine engine;
+  engine.rootContext()->setContextProperty("Settings", &settings);
+  engine.rootContext()->setContextProperty("ProjecteurApp", &projecteurApp);
+  engine.rootContext()->setContextProperty("SpotController", &spotController);
+
+  QQmlComponent component(&engine, QUrl(QStringLiteral("qrc:/main.qml")));
+  std::unique_ptr<QObject> object(component.create());
+  const auto window = qobject_cast<QQuickWindow*>(object.get());
+  if (!window)
+  {
+    for (const auto& error : component.errors()) { QTextStream(stderr) << error.toString() << '\n'; }
+    return 1;
+  }
+
+  const auto timing = new FrameTiming(window);
+  window->setProperty("screenId", 1);
+  window->setProperty("desktopImage", desktopImage(windowSize));
+  window->setGeometry(QRect(QPoint(0, 0), windowSize));
+  window->show();
+  spotController.setVisible(true);
+  spotController.addSample(QPointF(windowSize.width() / 2.0, windowSize.height() / 2.0));
+  if (!waitForFrame(window))
+  {
+    QTextStream(stderr) << "No frame rendered, is the window exposed?" << '\n';
+    return 1;
+  }
+
+  out << "Platform: " << QGuiApplication::platformName()
+      << ", scene graph backend: " << QQuickWindow::sceneGraphBackend()
+      << ", window: " << windowSize.width() << "x" << windowSize.height()
+      << ", frames per configuration: " << frames << "\n\n";
+  out << QString("%1 %2 %3 %4 | %5 %6 %7 %8 | %9 %10")
+         .arg("shape", -8).arg("zoom", -4).arg("border", -6).arg("rot", 3)
+         .arg("p50", 7).arg("p90", 7).arg("p99", 7).arg("max", 7)
+         .arg("render p99", 10).arg("sync p99", 8) << '\n';
+
+  const QStringList shapeFiles = {"spotshapes/Circle.qml", "spotshapes/Square.qml",
+                                  "spotshapes/Star.qml", "spotshapes/Ngon.qml"};
+  for (const auto& shape : shapeFiles) {
+    for (const bool zoom : {false, true}) {
+      for (const bool border : {false, true}) {
+        for (const qreal rotation : {0.0, 30.0})
+        {
+          applyConfiguration(settings, Configuration{shape, zoom, border, rotation});
+
+          // Warm up: caches, texture uploads and the fade in of the first configuration.
+          for (int i = 0; i < 30; ++i) {
+            spotController.addSample(cursorPosition(windowSize, i, frames));
+            waitForFrame(window);
+          }
+
+          timing->reset();
+          for (int i = 0; i < frames; ++i) {
+            spotController.addSample(cursorPosition(windowSize, i, frames));
+            waitForFrame(window);
+          }
+
+          const auto s = timing->stats();
+          const QString name = QString(shape).remove("spotshapes/").remove(".qml");
+          out << QString("%1 %2 %3 %4 | %5 %6 %7 %8 | %9 %10")
+                 .arg(name, -8).arg(zoom ? "on" : "off", -4).arg(border ? "on" : "off", -6)
+                 .arg(rotation, 3, 'f', 0)
+                 .arg(ms(s.frame.percentile(50)), 7).arg(ms(s.frame.percentile(90)), 7)
+                 .arg(ms(s.frame.percentile(99)), 7).arg(ms(s.frame.max()), 7)
+                 .arg(ms(s.render.percentile(99)), 10).arg(ms(s.sync.percentile(99)), 8) << '\n';
+        }
+      }
+    }
+  }
+
+  out << "\nTimes in milliseconds. Frame time = sync + render + swap." << '\n';
+  return 0;
+}
@@ -1,5 +1,5 @@
 list(APPEND _PkgDeps_Projecteur_opensuse
-  "libqt5-qtgraphicaleffects >= 5.7"
+  "libQt5Quick5 >= 5.7"
   "libQt5Widgets5 >= 5.7"
   "libQt5X11Extras5 >= 5.7"
   "libQt5DBus5 >= 5.7"
@@ -10,7 +10,6 @@ list(APPEND _PkgDeps_Projecteur_opensuse
 list(APPEND _PkgDeps_Projecteur_fedora
   "qt5-qtbase >= 5.7"
   "qt5-qtdeclarative >= 5.7"
-  "qt5-qtgraphicaleffects >= 5.7"
   "qt5-qtx11extras >= 5.7"
   "passwd"
   "udev"
@@ -19,14 +18,14 @@ list(APPEND _PkgDeps_Projecteur_fedora
 list(APPEND _PkgDeps_Projecteur_centos
   "qt5-qtbase >= 5.7"
   "qt5-qtdeclarative >= 5.7"
-  "qt5-qtgraphicaleffects >= 5.7"
   "qt5-qtx11extras >= 5.7"
   "passwd"
   "udev"
 )
 
 list(APPEND _PkgDeps_Projecteur_debian
-  "qml-module-qtgraphicaleffects (>= 5.7)"
+  "qml-module-qtquick2 (>= 5.7)"
+  "qml-module-qtquick-window2 (>= 5.7)"
   "libqt5widgets5 (>= 5.7)"
   "libqt5x11extras5 (>= 5.7)"
   "passwd"
@@ -37,7 +36,6 @@ list(APPEND _PkgDeps_Projecteur_debian
 list(APPEND _PkgDeps_Projecteur_archlinux
   "qt5-base>=5.7"
   "qt5-declarative>=5.7"
-  "qt5-graphicaleffects>=5.7"
   "qt5-x11extras>=5.7"
   "udev"
 )
@@ -1,10 +0,0 @@
-// This file is part of Projecteur - https://github.com/jahnf/projecteur - See LICENSE.md and README.md
-import QtQuick 2.3
-
-// Circle spotlight shape
-Rectangle {
-    anchors.fill: parent
-    radius: width * 0.5
-    visible: false
-    enabled: false
-}
@@ -8,6 +8,16 @@
 #include <QMetaType>
 #include <QString>
 
+#include <linux/input.h>
+
+// REL_WHEEL_HI_RES and REL_HWHEEL_HI_RES are only defined in newer linux versions
+#ifndef REL_WHEEL_HI_RES
+#define REL_WHEEL_HI_RES 0x0b
+#endif
+#ifndef REL_HWHEEL_HI_RES
+#define REL_HWHEEL_HI_RES 0x0c
+#endif
+
 // Bus on which device is connected
 enum class BusType : uint8_t { Unknown, Usb, Bluetooth };
 
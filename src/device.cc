@@ -8,6 +8,7 @@
 #include "enum-helper.h"
 #include "hidpp.h"
 #include "logging.h"
+#include "virtualdevice.h"
 
 #include <QSocketNotifier>
 #include <QTimer>
@@ -27,6 +28,51 @@ namespace  {
 
   const auto hexId = logging::hexId;
   // class i18n : public QObject {}; // for i18n and logging
+
+  // -----------------------------------------------------------------------------------------------
+  template<size_t N>
+  void readEventBits(int evfd, int evType, std::bitset<N>& bits)
+  {
+    constexpr size_t bitsPerLong = sizeof(unsigned long) * 8;
+    std::array<unsigned long, (N + bitsPerLong - 1) / bitsPerLong> data{};
+    if (ioctl(evfd, EVIOCGBIT(evType, sizeof(data)), data.data()) < 0) { return; }
+
+    for (size_t i = 0; i < N; ++i) {
+      if (data[i / bitsPerLong] & (1ul << (i % bitsPerLong))) { bits.set(i); }
+    }
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Add the key and relative axis codes of an event device to the virtual devices
+  /// of the input mapper. Key codes are split like the input mapper forwards them, relative axis
+  /// codes are added to both.
+  void announceEventCodes(int evfd, unsigned long evTypes, const InputMapper& inputMapper)
+  {
+    VirtualDevice::Capabilities mouseCaps;
+    VirtualDevice::Capabilities keyboardCaps;
+
+    if (!!(evTypes & (1 << EV_KEY)))
+    {
+      VirtualDevice::Capabilities caps;
+      readEventBits(evfd, EV_KEY, caps.keys);
+      for (size_t code = 0; code < caps.keys.size(); ++code)
+      {
+        if (!caps.keys[code]) { continue; }
+        if (code >= BTN_MISC && code < KEY_OK) { mouseCaps.keys.set(code); }
+        else { keyboardCaps.keys.set(code); }
+      }
+    }
+    if (!!(evTypes & (1 << EV_REL)))
+    {
+      readEventBits(evfd, EV_REL, mouseCaps.rels);
+      // Frames that do not start with a mouse button event, e.g. wheel frames, are
+      // forwarded to the virtual keyboard, see InputMapper::Impl::forwardEvents.
+      keyboardCaps.rels = mouseCaps.rels;
+    }
+
+    if (const auto vmouse = inputMapper.virtualMouse()) { vmouse->addCapabilities(mouseCaps); }
+    if (const auto vkeyboard = inputMapper.virtualKeyboard()) { vkeyboard->addCapabilities(keyboardCaps); }
+  }
 } // end anonymous namespace
 
 // -------------------------------------------------------------------------------------------------
@@ -243,11 +289,14 @@ std::shared_ptr<SubEventConnection> SubEventConnection::create(const DeviceScan:
     }
   }
 
-  connection->m_details.grabbed = [&dc, evfd, &sd]()
+  connection->m_details.grabbed = [&dc, evfd, &sd, bitmask]()
   {
     // Grab device inputs if a virtual device exists.
     if (dc.inputMapper()->hasVirtualDevice())
     {
+      // Events of grabbed devices are forwarded, announce their codes to the virtual devices.
+      announceEventCodes(evfd, bitmask, *dc.inputMapper());
+
       const int res = ioctl(evfd, EVIOCGRAB, 1);
       if (res == 0) { return true; }
 
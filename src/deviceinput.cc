@@ -3,6 +3,7 @@
 
 #include "deviceinput.h"
 
+#include "device-defs.h"
 #include "enum-helper.h"
 #include "logging.h"
 #include "settings.h"
@@ -10,8 +11,10 @@
 
 #include <algorithm>
 #include <list>
+#include <map>
 #include <type_traits>
 
+#include <QCryptographicHash>
 #include <QTimer>
 
 #include <linux/input.h>
@@ -236,6 +239,24 @@ namespace  {
     std::vector<KeyEventItem*> nextMap;
   };
 
+  /// Immutable key event tree compiled from an InputMapConfig. Instances are shared between all
+  /// devices with an identical input map configuration, see sharedKeyMap().
+  struct CompiledKeyMap
+  {
+    explicit CompiledKeyMap(InputMapConfig config);
+
+    const InputMapConfig& config() const { return m_config; }
+    const KeyEventItem* root() const { return &m_rootItem; }
+    bool empty() const { return m_rootItem.nextMap.empty(); }
+
+  private:
+    const InputMapConfig m_config;
+    std::list<KeyEventItem> m_items;
+    KeyEventItem m_rootItem;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  /// Per device key map state, consisting of a shared compiled key map and a cursor into it.
   struct DeviceKeyMap
   {
     explicit DeviceKeyMap(const InputMapConfig& config = {}) { reconfigure(config); }
@@ -248,16 +269,105 @@ namespace  {
 
     auto state() const { return m_pos; }
     void resetState();
-    void reconfigure(const InputMapConfig& config = {});
-    bool hasConfig() const { return !m_rootItem.nextMap.empty(); }
+    void reconfigure(InputMapConfig config = {});
+    bool hasConfig() const { return !m_keyMap->empty(); }
+    const InputMapConfig& config() const { return m_keyMap->config(); }
 
   private:
-    std::list<KeyEventItem> m_items;
-    KeyEventItem m_rootItem;
-    const KeyEventItem* m_pos = &m_rootItem;
+    std::shared_ptr<const CompiledKeyMap> m_keyMap;
+    const KeyEventItem* m_pos = nullptr;
   };
 } // end anonymous namespace
 
+// -------------------------------------------------------------------------------------------------
+CompiledKeyMap::CompiledKeyMap(InputMapConfig config)
+  : m_config(std::move(config))
+{
+  // -- fill keymaps
+  for (const auto& configItem : m_config)
+  {
+    // sanity check
+    if (!configItem.second.action) { continue; }
+
+    KeyEventItem* previous = nullptr;
+    KeyEventItem* current = &m_rootItem;
+    const auto& kes = configItem.first;
+
+    for (size_t i = 0; i < kes.size(); ++i) {
+      const auto& keyEvent = kes[i];
+      const auto it = std::find_if(current->nextMap.cbegin(), current->nextMap.cend(),
+      [&keyEvent](const KeyEventItem* item) {
+        return (item && item->keyEvent == keyEvent);
+      });
+
+      previous = current;
+
+      if (it != current->nextMap.cend()) {
+        current = *it;
+      }
+      else {
+        // Create new item if not found
+        m_items.emplace_back(KeyEventItem{keyEvent});
+        current = &m_items.back();
+        // link previous to current
+        previous->nextMap.push_back(current);
+      }
+
+      // if last item in key event sequence
+      if (i == kes.size() - 1) {
+        current->action = configItem.second.action;
+      }
+    }
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+namespace {
+  // -----------------------------------------------------------------------------------------------
+  /// Return a compiled key map for the given configuration. Key maps are deduplicated by a hash
+  /// of the serialized configuration, so that identical devices share the same compiled map.
+  std::shared_ptr<const CompiledKeyMap> sharedKeyMap(InputMapConfig config)
+  {
+    static const std::shared_ptr<const CompiledKeyMap> emptyKeyMap
+      = std::make_shared<CompiledKeyMap>(InputMapConfig{});
+    if (config.empty()) { return emptyKeyMap; }
+
+    const QByteArray hash = [&config]() {
+      QByteArray serialized;
+      {
+        QDataStream s(&serialized, QIODevice::WriteOnly);
+        for (const auto& item : config) {
+          if (item.second.action) { s << item.first << item.second; }
+        }
+      }
+      return QCryptographicHash::hash(serialized, QCryptographicHash::Sha1);
+    }();
+
+    // Compiled key maps are only cached as long as at least one device is using them.
+    static std::map<QByteArray, std::weak_ptr<const CompiledKeyMap>> cache;
+
+    for (auto it = cache.begin(); it != cache.end(); ) {
+      if (it->second.expired()) { it = cache.erase(it); } else { ++it; }
+    }
+
+    const auto it = cache.find(hash);
+    if (it != cache.cend())
+    {
+      auto keyMap = it->second.lock();
+      if (keyMap && keyMap->config() == config)
+      {
+        logDebug(input) << "Sharing compiled input map, use count =" << keyMap.use_count();
+        return keyMap;
+      }
+    }
+
+    std::shared_ptr<const CompiledKeyMap> keyMap
+      = std::make_shared<CompiledKeyMap>(std::move(config));
+    cache[hash] = keyMap;
+    return keyMap;
+  }
+} // end anonymous namespace
+
 // -------------------------------------------------------------------------------------------------
 DeviceKeyMap::Result DeviceKeyMap::feed(const struct input_event input_events[], size_t num)
 {
@@ -291,53 +401,14 @@ DeviceKeyMap::Result DeviceKeyMap::feed(const struct input_event input_events[],
 // -------------------------------------------------------------------------------------------------
 void DeviceKeyMap::resetState()
 {
-  m_pos = &m_rootItem;
+  m_pos = m_keyMap->root();
 }
 
 // -------------------------------------------------------------------------------------------------
-void DeviceKeyMap::reconfigure(const InputMapConfig& config)
+void DeviceKeyMap::reconfigure(InputMapConfig config)
 {
-  // -- clear maps + state
+  m_keyMap = sharedKeyMap(std::move(config));
   resetState();
-  m_rootItem.nextMap.clear();
-  m_items.clear();
-
-    // -- fill keymaps
-  for (const auto& configItem : config)
-  {
-    // sanity check
-    if (!configItem.second.action) { continue; }
-
-    KeyEventItem* previous = nullptr;
-    KeyEventItem* current = &m_rootItem;
-    const auto& kes = configItem.first;
-
-    for (size_t i = 0; i < kes.size(); ++i) {
-      const auto& keyEvent = kes[i];
-      const auto it = std::find_if(current->nextMap.cbegin(), current->nextMap.cend(),
-      [&keyEvent](const KeyEventItem* item) {
-        return (item && item->keyEvent == keyEvent);
-      });
-
-      previous = current;
-
-      if (it != current->nextMap.cend()) {
-        current = *it;
-      }
-      else {
-        // Create new item if not found
-        m_items.emplace_back(KeyEventItem{keyEvent});
-        current = &m_items.back();
-        // link previous to current
-        previous->nextMap.push_back(current);
-      }
-
-      // if last item in key event sequence
-      if (i == kes.size() - 1) {
-        current->action = configItem.second.action;
-      }
-    }
-  }
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -580,6 +651,7 @@ struct InputMapper::Impl
   void emitNativeKeySequence(const NativeKeySequence& ks);
   void execAction(const std::shared_ptr<Action>& action, DeviceKeyMap::Result r);
   bool hasVirtualDevices() const;
+  void announceActionCodes() const;
 
   void forwardEvents(const struct input_event input_events[], size_t num);
   void forwardEvents(const std::vector<struct input_event>& input_events);
@@ -595,7 +667,6 @@ struct InputMapper::Impl
 
   std::pair<DeviceKeyMap::Result, const KeyEventItem*> m_lastState;
   std::vector<input_event> m_events;
-  InputMapConfig m_config;
   bool m_recordingMode = false;
 
   SpecialMoveInputs m_specialMoveInputs;
@@ -622,6 +693,51 @@ bool InputMapper::Impl::hasVirtualDevices() const
   return (m_vmouse && m_vkeyboard);
 }
 
+// -------------------------------------------------------------------------------------------------
+// Add the event codes that mapped actions emit to the virtual devices, so they exist before
+// the first action is triggered.
+void InputMapper::Impl::announceActionCodes() const
+{
+  if (!hasVirtualDevices()) { return; }
+
+  VirtualDevice::Capabilities mouseCaps;
+  VirtualDevice::Capabilities keyboardCaps;
+
+  for (const auto& item : m_keymap.config())
+  {
+    const auto& action = item.second.action;
+    if (!action || action->empty()) { continue; }
+
+    switch (action->type())
+    {
+    case Action::Type::KeySequence: {
+      const auto& ks = static_cast<KeySequenceAction*>(action.get())->keySequence;
+      for (const auto& ke : ks.nativeSequence()) {
+        for (const auto& ie : ke) {
+          if (ie.type == EV_KEY && ie.code < keyboardCaps.keys.size()) { keyboardCaps.keys.set(ie.code); }
+        }
+      }
+      break;
+    }
+    case Action::Type::ScrollHorizontal:
+      mouseCaps.rels.set(REL_HWHEEL).set(REL_HWHEEL_HI_RES);
+      break;
+    case Action::Type::ScrollVertical:
+      mouseCaps.rels.set(REL_WHEEL).set(REL_WHEEL_HI_RES);
+      break;
+    case Action::Type::VolumeControl: // Volume keys are emitted via the virtual mouse
+      mouseCaps.keys.set(KEY_VOLUMEUP).set(KEY_VOLUMEDOWN);
+      break;
+    case Action::Type::CyclePresets: // fall through
+    case Action::Type::ToggleSpotlight:
+      break;
+    }
+  }
+
+  m_vmouse->addCapabilities(mouseCaps);
+  m_vkeyboard->addCapabilities(keyboardCaps);
+}
+
 // -------------------------------------------------------------------------------------------------
 void InputMapper::Impl::execAction(const std::shared_ptr<Action>& action, DeviceKeyMap::Result r)
 {
@@ -917,29 +1033,29 @@ void InputMapper::resetState()
 // -------------------------------------------------------------------------------------------------
 void InputMapper::setConfiguration(const InputMapConfig& config)
 {
-  if (config == impl->m_config) { return; }
+  if (config == impl->m_keymap.config()) { return; }
 
-  impl->m_config = config;
   impl->resetState();
-  impl->m_keymap.reconfigure(impl->m_config);
+  impl->m_keymap.reconfigure(config);
+  impl->announceActionCodes();
   emit configurationChanged();
 }
 
 // -------------------------------------------------------------------------------------------------
 void InputMapper::setConfiguration(InputMapConfig&& config)
 {
-  if (config == impl->m_config) { return; }
+  if (config == impl->m_keymap.config()) { return; }
 
-  impl->m_config.swap(config);
   impl->resetState();
-  impl->m_keymap.reconfigure(impl->m_config);
+  impl->m_keymap.reconfigure(std::move(config));
+  impl->announceActionCodes();
   emit configurationChanged();
 }
 
 // -------------------------------------------------------------------------------------------------
 const InputMapConfig& InputMapper::configuration() const
 {
-  return impl->m_config;
+  return impl->m_keymap.config();
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -232,7 +232,8 @@ struct ScrollHorizontalAction : public Action
   bool operator==(const ScrollHorizontalAction&) const { return true; }
   bool placeholder = false;
 
-  int param = 0;
+  int param = 0;       ///< Whole wheel notches
+  int hiResParam = 0;  ///< High-resolution wheel movement in 1/120 of a notch
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -245,7 +246,8 @@ struct ScrollVerticalAction : public Action
   bool operator==(const ScrollVerticalAction&) const { return true; }
   bool placeholder = false;
 
-  int param = 0;
+  int param = 0;       ///< Whole wheel notches
+  int hiResParam = 0;  ///< High-resolution wheel movement in 1/120 of a notch
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -0,0 +1,198 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+
+#include "frametiming.h"
+
+#include <QQuickWindow>
+#include <QScreen>
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+  // -----------------------------------------------------------------------------------------------
+  QString ms(qint64 us) {
+    return QString::number(us / 1000.0, 'f', 2);
+  }
+} // end anonymous namespace
+
+// -------------------------------------------------------------------------------------------------
+const std::array<qint64, FrameTiming::Histogram::BucketCount>& FrameTiming::Histogram::upperBounds()
+{
+  // 14us up to ~2.6s, the last bucket also takes everything above.
+  static const auto bounds = []()
+  {
+    std::array<qint64, BucketCount> b{};
+    for (int i = 0; i < BucketCount; ++i) {
+      b[static_cast<size_t>(i)] = std::llround(10.0 * std::pow(2.0, (i + 1) / 4.0));
+    }
+    return b;
+  }();
+  return bounds;
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameTiming::Histogram::add(qint64 us)
+{
+  us = std::max<qint64>(0, us);
+  const auto& bounds = upperBounds();
+  const auto it = std::lower_bound(bounds.cbegin(), bounds.cend() - 1, us);
+  ++m_buckets[static_cast<size_t>(it - bounds.cbegin())];
+  ++m_count;
+  m_sum += us;
+  m_max = std::max(m_max, us);
+}
+
+// -------------------------------------------------------------------------------------------------
+qint64 FrameTiming::Histogram::percentile(double p) const
+{
+  if (m_count == 0) { return 0; }
+
+  const auto rank = static_cast<quint64>(std::ceil(qBound(0.0, p, 100.0) / 100.0 * m_count));
+  quint64 cumulated = 0;
+  for (int i = 0; i < BucketCount; ++i)
+  {
+    cumulated += m_buckets[static_cast<size_t>(i)];
+    if (cumulated >= std::max<quint64>(rank, 1)) {
+      return std::min(upperBounds()[static_cast<size_t>(i)], m_max);
+    }
+  }
+  return m_max;
+}
+
+// -------------------------------------------------------------------------------------------------
+QString FrameTiming::Histogram::summary() const
+{
+  if (m_count == 0) { return tr("no samples"); }
+  return tr("%1 samples, mean %2 ms, p50 %3 ms, p90 %4 ms, p99 %5 ms, max %6 ms")
+    .arg(m_count).arg(ms(mean())).arg(ms(percentile(50))).arg(ms(percentile(90)))
+    .arg(ms(percentile(99))).arg(ms(m_max));
+}
+
+// -------------------------------------------------------------------------------------------------
+FrameTiming::FrameTiming(QQuickWindow* window)
+  : QObject(window)
+  , m_window(window)
+{
+  // All scene graph signals are emitted on the render thread with the threaded render loop.
+  connect(window, &QQuickWindow::beforeSynchronizing, this, [this](){
+    m_syncStart = now();
+    if (m_frameStart == 0) { m_frameStart = m_syncStart; }
+  }, Qt::DirectConnection);
+  connect(window, &QQuickWindow::afterSynchronizing, this, [this](){
+    if (m_syncStart > 0) { m_frameSync = now() - m_syncStart; }
+    m_syncStart = 0;
+  }, Qt::DirectConnection);
+  connect(window, &QQuickWindow::beforeRendering, this, [this](){
+    m_renderStart = now();
+  }, Qt::DirectConnection);
+  connect(window, &QQuickWindow::afterRendering, this, [this](){
+    m_renderEnd = now();
+    if (m_renderStart > 0) { m_frameRender = m_renderEnd - m_renderStart; }
+    m_renderStart = 0;
+  }, Qt::DirectConnection);
+  connect(window, &QQuickWindow::frameSwapped, this, [this](){ onFrameSwapped(); },
+          Qt::DirectConnection);
+
+  connect(window, &QWindow::screenChanged, this, [this](){ updateRefreshInterval(); });
+  updateRefreshInterval();
+}
+
+// -------------------------------------------------------------------------------------------------
+FrameTiming::~FrameTiming() = default;
+
+// -------------------------------------------------------------------------------------------------
+FrameTiming* FrameTiming::of(QQuickWindow* window)
+{
+  return window ? window->findChild<FrameTiming*>(QString(), Qt::FindDirectChildrenOnly) : nullptr;
+}
+
+// -------------------------------------------------------------------------------------------------
+qint64 FrameTiming::now()
+{
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameTiming::updateRefreshInterval()
+{
+  const qreal refreshRate = (m_window && m_window->screen()) ? m_window->screen()->refreshRate() : 0.0;
+  m_refreshIntervalUs = std::llround(1e6 / (refreshRate >= 1.0 ? refreshRate : 60.0));
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameTiming::onFrameSwapped()
+{
+  const qint64 t = now();
+  const qint64 activationTime = m_activationTimeUs.exchange(0);
+  const qint64 refresh = m_refreshIntervalUs;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.frames;
+    const qint64 swap = (m_renderEnd > 0) ? t - m_renderEnd : -1;
+    if (m_frameSync >= 0) { m_stats.sync.add(m_frameSync); }
+    if (m_frameRender >= 0) { m_stats.render.add(m_frameRender); }
+    if (swap >= 0) { m_stats.swap.add(swap); }
+    m_stats.frame.add(std::max<qint64>(0, m_frameSync) + std::max<qint64>(0, m_frameRender)
+                      + std::max<qint64>(0, swap));
+
+    // The overlay is only rendered on request. A frame whose synchronization started right after
+    // the previous swap was already requested before, only then the interval is part of an
+    // animation. Otherwise it includes idle time without any request, e.g. a cursor pause.
+    const qint64 interval = t - m_lastSwap;
+    if (m_lastSwap > 0 && m_frameStart > 0 && 2 * (m_frameStart - m_lastSwap) < refresh)
+    {
+      m_stats.interval.add(interval);
+      if (2 * interval > 3 * refresh) {
+        m_stats.droppedFrames += static_cast<quint64>((interval + refresh / 2) / refresh - 1);
+      }
+    }
+
+    if (activationTime > 0) { m_stats.activation.add(t - activationTime); }
+  }
+
+  m_lastSwap = t;
+  m_frameStart = 0;
+  m_renderEnd = 0;
+  m_frameSync = m_frameRender = -1;
+  if (activationTime > 0) { emit activationFrameSwapped(t - activationTime); }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameTiming::markActivation()
+{
+  m_activationTimeUs = now();
+}
+
+// -------------------------------------------------------------------------------------------------
+FrameTiming::Stats FrameTiming::stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+// -------------------------------------------------------------------------------------------------
+void FrameTiming::reset()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats = Stats();
+}
+
+// -------------------------------------------------------------------------------------------------
+QString FrameTiming::report() const
+{
+  const Stats s = stats();
+  return QStringList{
+    tr("frame: %1").arg(s.frame.summary()),
+    tr("sync: %1").arg(s.sync.summary()),
+    tr("render: %1").arg(s.render.summary()),
+    tr("swap: %1").arg(s.swap.summary()),
+    tr("frame interval: %1").arg(s.interval.summary()),
+    tr("frames: %1, dropped: %2 (refresh interval %3 ms)")
+      .arg(s.frames).arg(s.droppedFrames).arg(ms(m_refreshIntervalUs)),
+    tr("activation to first frame: %1").arg(s.activation.summary()),
+  }.join('\n');
+}
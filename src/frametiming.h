@@ -0,0 +1,100 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+class QQuickWindow;
+
+/// Frame timing of a QQuickWindow, collected from the scene graph signals of the window on the
+/// render thread: synchronization, rendering and swap durations, the interval between frames and
+/// dropped frames, as well as the time from a spot activation to the next swapped frame.
+class FrameTiming : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// Histogram of durations in microseconds with logarithmic buckets (four per octave).
+  class Histogram
+  {
+  public:
+    void add(qint64 us);
+    quint64 count() const { return m_count; }
+    qint64 max() const { return m_max; }
+    qint64 mean() const { return m_count ? m_sum / static_cast<qint64>(m_count) : 0; }
+    /// Upper bound of the bucket containing the given percentile (0-100), at most max().
+    qint64 percentile(double p) const;
+    /// e.g. '120 samples, mean 1.2 ms, p50 1.1 ms, p90 1.6 ms, p99 3.4 ms, max 5.0 ms'
+    QString summary() const;
+
+  private:
+    static constexpr int BucketCount = 72;
+    static const std::array<qint64, BucketCount>& upperBounds();
+
+    std::array<quint64, BucketCount> m_buckets{};
+    quint64 m_count = 0;
+    qint64 m_sum = 0;
+    qint64 m_max = 0;
+  };
+
+  struct Stats
+  {
+    Histogram frame;      ///< Sum of sync, render and swap of each frame
+    Histogram sync;       ///< Synchronization of the scene graph with the items (GUI thread blocked)
+    Histogram render;     ///< Rendering of the scene graph
+    Histogram swap;       ///< From the end of rendering until the buffer swap returned
+    Histogram interval;   ///< Between two consecutive frames of an animation (requested back to back)
+    Histogram activation; ///< From a spot activation to the next swapped frame
+    quint64 frames = 0;
+    quint64 droppedFrames = 0;
+  };
+
+  /// Collects the frame timing of window until it is destroyed, the object is a child of window.
+  explicit FrameTiming(QQuickWindow* window);
+  ~FrameTiming() override;
+
+  /// Return the timing of the given window or nullptr if it was never attached.
+  static FrameTiming* of(QQuickWindow* window);
+
+  Stats stats() const;
+  void reset();
+  /// Multi line report of all histograms, see Histogram::summary().
+  QString report() const;
+
+  /// Mark a spot activation, the time until the next swapped frame is added to the
+  /// activation histogram and reported with activationFrameSwapped().
+  void markActivation();
+
+  /// Monotonic time in microseconds.
+  static qint64 now();
+
+signals:
+  /// First frame after markActivation() was swapped, emitted on the render thread.
+  void activationFrameSwapped(qint64 latencyUs);
+
+private:
+  void onFrameSwapped();
+  void updateRefreshInterval();
+
+  QPointer<QQuickWindow> m_window;
+  std::atomic<qint64> m_refreshIntervalUs{16667};
+  std::atomic<qint64> m_activationTimeUs{0};
+
+  // Only used on the render thread
+  qint64 m_syncStart = 0;
+  qint64 m_frameStart = 0; // first synchronization since the last swap
+  qint64 m_renderStart = 0;
+  qint64 m_renderEnd = 0;
+  qint64 m_lastSwap = 0;
+  qint64 m_frameSync = -1;
+  qint64 m_frameRender = -1;
+
+  mutable std::mutex m_mutex;
+  Stats m_stats;
+};
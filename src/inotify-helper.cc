@@ -0,0 +1,60 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+
+#include "inotify-helper.h"
+
+#include <QFile>
+#include <QSocketNotifier>
+#include <QVarLengthArray>
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace inotify {
+// -------------------------------------------------------------------------------------------------
+QSocketNotifier* watch(const QString& path, uint32_t mask, QObject* parent, EventCallback callback)
+{
+  int fd = -1;
+#if defined(IN_CLOEXEC)
+  fd = inotify_init1(IN_CLOEXEC);
+#endif
+  if (fd == -1)
+  {
+    fd = inotify_init();
+    if (fd == -1) { return nullptr; }
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  if (inotify_add_watch(fd, QFile::encodeName(path).constData(), mask) < 0) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  const auto notifier = new QSocketNotifier(fd, QSocketNotifier::Read, parent);
+  QObject::connect(notifier, &QSocketNotifier::activated, parent,
+  [fd, callback = std::move(callback)]()
+  {
+    int bytesAvailable = 0;
+    if (ioctl(fd, FIONREAD, &bytesAvailable) < 0 || bytesAvailable <= 0) {
+      return; // Error or no bytes available
+    }
+    QVarLengthArray<char, 2048> buffer(bytesAvailable);
+    const auto bytesRead = read(fd, buffer.data(), static_cast<size_t>(bytesAvailable));
+    if (bytesRead <= 0) { return; }
+
+    const char* at = buffer.data();
+    const char* const end = at + bytesRead;
+    while (at < end)
+    {
+      const auto event = reinterpret_cast<const inotify_event*>(at);
+      callback(event->mask, event->len ? QFile::decodeName(event->name) : QString());
+      at += sizeof(inotify_event) + event->len;
+    }
+  });
+
+  QObject::connect(notifier, &QSocketNotifier::destroyed, [fd]() { ::close(fd); });
+  return notifier;
+}
+} // end namespace inotify
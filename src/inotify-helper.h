@@ -0,0 +1,21 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+#pragma once
+
+#include <QString>
+
+#include <cstdint>
+#include <functional>
+
+class QObject;
+class QSocketNotifier;
+
+namespace inotify {
+  /// Called with the event mask and the name of the file in the watched directory (can be empty).
+  using EventCallback = std::function<void(uint32_t mask, const QString& name)>;
+
+  /// Watch path with inotify for the events in mask. The returned notifier is a child of parent,
+  /// the inotify file descriptor is closed when it is destroyed. Returns nullptr on failure.
+  QSocketNotifier* watch(const QString& path, uint32_t mask, QObject* parent,
+                         EventCallback callback);
+}
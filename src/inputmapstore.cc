@@ -0,0 +1,237 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+
+#include "inputmapstore.h"
+
+#include "deviceinput.h"
+#include "logging.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <array>
+#include <cstring>
+
+LOGGING_CATEGORY(inputmapstore, "inputmapstore")
+
+namespace {
+  // -----------------------------------------------------------------------------------------------
+  constexpr char Magic[4] = {'P', 'J', 'I', 'M'};
+  // magic, version, reserved, source checksum, entries, payload size, payload crc
+  constexpr int HeaderSize = 4 + 2 + 2 + 4 + 4 + 4 + 4;
+  constexpr auto StreamVersion = QDataStream::Qt_5_6;
+
+  // -----------------------------------------------------------------------------------------------
+  quint32 crc32(const uchar* data, qint64 size)
+  {
+    static const auto table = []()
+    {
+      std::array<quint32, 256> t{};
+      for (quint32 i = 0; i < t.size(); ++i)
+      {
+        quint32 c = i;
+        for (int k = 0; k < 8; ++k) { c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : (c >> 1); }
+        t[i] = c;
+      }
+      return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (qint64 i = 0; i < size; ++i) { crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8); }
+    return crc ^ 0xFFFFFFFFu;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  template<typename T>
+  void append(QByteArray& ba, T value)
+  {
+    const T le = qToLittleEndian(value);
+    ba.append(reinterpret_cast<const char*>(&le), sizeof(le));
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  struct Reader
+  {
+    const uchar* pos;
+    const uchar* const end;
+
+    template<typename T>
+    bool read(T& value)
+    {
+      if (static_cast<size_t>(end - pos) < sizeof(T)) { return false; }
+      value = qFromLittleEndian<T>(pos);
+      pos += sizeof(T);
+      return true;
+    }
+
+    bool skip(quint32 size)
+    {
+      if (static_cast<size_t>(end - pos) < size) { return false; }
+      pos += size;
+      return true;
+    }
+  };
+} // end anonymous namespace
+
+namespace InputMapStore {
+// -------------------------------------------------------------------------------------------------
+quint32 checksum(const QByteArray& data)
+{
+  return crc32(reinterpret_cast<const uchar*>(data.constData()), data.size());
+}
+
+// -------------------------------------------------------------------------------------------------
+QByteArray serialize(const InputMapConfig& config, quint32 sourceChecksum)
+{
+  QByteArray payload;
+  quint32 entries = 0;
+  for (const auto& item : config)
+  {
+    if (!item.second.action) { continue; }
+
+    append<quint16>(payload, static_cast<quint16>(item.first.size()));
+    for (const auto& keyEvent : item.first)
+    {
+      append<quint16>(payload, static_cast<quint16>(keyEvent.size()));
+      for (const auto& event : keyEvent)
+      {
+        append<quint16>(payload, event.type);
+        append<quint16>(payload, event.code);
+        append<qint32>(payload, event.value);
+      }
+    }
+
+    QByteArray action;
+    {
+      QDataStream s(&action, QIODevice::WriteOnly);
+      s.setVersion(StreamVersion);
+      s << item.second;
+    }
+    append<quint32>(payload, static_cast<quint32>(action.size()));
+    payload.append(action);
+    ++entries;
+  }
+
+  QByteArray store;
+  store.reserve(HeaderSize + payload.size());
+  store.append(Magic, sizeof(Magic));
+  append<quint16>(store, Version);
+  append<quint16>(store, 0);
+  append<quint32>(store, sourceChecksum);
+  append<quint32>(store, entries);
+  append<quint32>(store, static_cast<quint32>(payload.size()));
+  append<quint32>(store, checksum(payload));
+  store.append(payload);
+  return store;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool deserialize(const uchar* data, qint64 size, InputMapConfig& config, quint32* sourceChecksum)
+{
+  if (size < HeaderSize || memcmp(data, Magic, sizeof(Magic)) != 0) { return false; }
+
+  Reader header{data + sizeof(Magic), data + HeaderSize};
+  quint16 version = 0, reserved = 0;
+  quint32 source = 0, entries = 0, payloadSize = 0, crc = 0;
+  header.read(version);
+  header.read(reserved);
+  header.read(source);
+  header.read(entries);
+  header.read(payloadSize);
+  header.read(crc);
+
+  if (version != Version) { return false; }
+  if (size - HeaderSize != payloadSize) { return false; }
+  if (crc32(data + HeaderSize, payloadSize) != crc) { return false; }
+
+  InputMapConfig cfg;
+  Reader r{data + HeaderSize, data + size};
+  for (quint32 i = 0; i < entries; ++i)
+  {
+    quint16 keyEventCount = 0;
+    if (!r.read(keyEventCount)) { return false; }
+
+    KeyEventSequence sequence(keyEventCount);
+    for (auto& keyEvent : sequence)
+    {
+      quint16 eventCount = 0;
+      if (!r.read(eventCount)) { return false; }
+      keyEvent.reserve(eventCount);
+      for (quint16 e = 0; e < eventCount; ++e)
+      {
+        quint16 type = 0, code = 0;
+        qint32 value = 0;
+        if (!r.read(type) || !r.read(code) || !r.read(value)) { return false; }
+        keyEvent.emplace_back(type, code, value);
+      }
+    }
+
+    quint32 actionSize = 0;
+    if (!r.read(actionSize)) { return false; }
+    const auto actionData = r.pos;
+    if (!r.skip(actionSize)) { return false; }
+
+    // Only referenced, the data is copied into the action while reading it.
+    const auto raw = QByteArray::fromRawData(reinterpret_cast<const char*>(actionData),
+                                             static_cast<int>(actionSize));
+    QDataStream s(raw);
+    s.setVersion(StreamVersion);
+    MappedAction mappedAction;
+    s >> mappedAction;
+    if (s.status() != QDataStream::Ok || !mappedAction.action) { return false; }
+
+    cfg.emplace(std::move(sequence), std::move(mappedAction));
+  }
+
+  if (r.pos != r.end) { return false; }
+
+  config.swap(cfg);
+  if (sourceChecksum) { *sourceChecksum = source; }
+  return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool save(const QString& filePath, const QByteArray& store)
+{
+  if (!QDir().mkpath(QFileInfo(filePath).absolutePath())) {
+    logWarning(inputmapstore) << QObject::tr("Cannot create directory for '%1'.").arg(filePath);
+    return false;
+  }
+
+  QSaveFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly) || file.write(store) != store.size() || !file.commit())
+  {
+    logWarning(inputmapstore) << QObject::tr("Cannot write input map store '%1': %2")
+                                 .arg(filePath, file.errorString());
+    return false;
+  }
+  return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool load(const QString& filePath, quint32 sourceChecksum, InputMapConfig& config)
+{
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly)) { return false; }
+
+  const auto size = file.size();
+  const auto data = file.map(0, size);
+  if (!data) { return false; }
+
+  quint32 source = 0;
+  InputMapConfig cfg;
+  const bool valid = deserialize(data, size, cfg, &source) && source == sourceChecksum;
+  file.unmap(data);
+
+  if (!valid) {
+    logDebug(inputmapstore) << QObject::tr("Input map store '%1' is outdated or invalid.").arg(filePath);
+    return false;
+  }
+  config.swap(cfg);
+  return true;
+}
+} // end namespace InputMapStore
@@ -0,0 +1,35 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+class InputMapConfig;
+
+// -------------------------------------------------------------------------------------------------
+/// Compact binary store of an input map configuration, used as a fast loading cache of the
+/// input maps in the settings file.
+///
+/// The store starts with a header: magic 'PJIM', format version, checksum of the settings entries
+/// the store was created from, entry count, payload size and a CRC-32 of the payload. The payload
+/// holds the entries, each with the device key event sequence as fixed size little endian values,
+/// followed by the mapped action as QDataStream data.
+/// Stores are loaded from memory mapped files.
+namespace InputMapStore
+{
+  constexpr quint16 Version = 2;
+
+  /// CRC-32 of data, e.g. of the raw settings entries a store is created from.
+  quint32 checksum(const QByteArray& data);
+
+  QByteArray serialize(const InputMapConfig& config, quint32 sourceChecksum);
+  /// Returns false if data is not a valid store of the current version, config is unchanged then.
+  bool deserialize(const uchar* data, qint64 size, InputMapConfig& config,
+                   quint32* sourceChecksum = nullptr);
+
+  /// Write the store atomically to filePath, missing directories are created.
+  bool save(const QString& filePath, const QByteArray& store);
+  /// Load the store at filePath if it is valid and was created from entries with sourceChecksum.
+  bool load(const QString& filePath, quint32 sourceChecksum, InputMapConfig& config);
+}
@@ -3,6 +3,7 @@
 
 #include "linuxdesktop.h"
 
+#include "asynchronous.h"
 #include "logging.h"
 
 #include <QApplication>
@@ -10,13 +11,26 @@
   #include <QDesktopWidget>
 #endif
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QPixmap>
 #include <QProcessEnvironment>
 #include <QScreen>
+#include <QStandardPaths>
 
 #if HAS_Qt_DBus
 #include <QDBusInterface>
 #include <QDBusReply>
+#include <QDBusUnixFileDescriptor>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 LOGGING_CATEGORY(desktop, "desktop")
@@ -24,9 +38,16 @@ LOGGING_CATEGORY(desktop, "desktop")
 namespace {
 #if HAS_Qt_DBus
   // -----------------------------------------------------------------------------------------------
-  QPixmap grabScreenDBusGnome()
+  // The GNOME Shell screenshot interface only writes PNG files. The file is written to the
+  // runtime directory (usually a tmpfs) and decoded on the calling (worker) thread.
+  QImage grabScreenDBusGnome()
   {
-    const auto filepath = QDir::temp().absoluteFilePath("000_projecteur_zoom_screenshot.png");
+    static std::atomic<int> counter{0};
+    auto dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (dir.isEmpty()) { dir = QDir::tempPath(); }
+    const auto filepath = QDir(dir).absoluteFilePath(QString("projecteur_zoom_%1_%2.png")
+                                                      .arg(QCoreApplication::applicationPid())
+                                                      .arg(counter++));
     QDBusInterface interface(QStringLiteral("org.gnome.Shell"),
                              QStringLiteral("/org/gnome/Shell/Screenshot"),
                              QStringLiteral("org.gnome.Shell.Screenshot"));
@@ -34,56 +55,115 @@ namespace {
 
     if (reply.value())
     {
-      QPixmap pm(filepath);
+      const QImage image(filepath);
       QFile::remove(filepath);
-      return pm;
+      return image;
     }
     logError(desktop) << LinuxDesktop::tr("Screenshot via GNOME DBus interface failed.");
-    return QPixmap();
+    return QImage();
   }
 
   // -----------------------------------------------------------------------------------------------
-  QPixmap grabScreenDBusKde()
+  // Read raw image data as written by the KWin ScreenShot2 interface.
+  QImage readRawImage(int fd, const QVariantMap& info)
   {
+    const int width = info.value(QStringLiteral("width")).toInt();
+    const int height = info.value(QStringLiteral("height")).toInt();
+    const int stride = info.value(QStringLiteral("stride")).toInt();
+    const auto format = static_cast<QImage::Format>(info.value(QStringLiteral("format")).toInt());
+    if (width <= 0 || height <= 0 || stride <= 0 || format == QImage::Format_Invalid) {
+      return QImage();
+    }
+
+    QImage image(width, height, format);
+    if (image.isNull()) { return image; }
+
+    QByteArray row(stride, Qt::Uninitialized);
+    const auto copyBytes = static_cast<size_t>(std::min<qint64>(stride, image.bytesPerLine()));
+    for (int y = 0; y < height; ++y)
+    {
+      for (int read = 0; read < stride; )
+      {
+        const auto r = ::read(fd, row.data() + read, static_cast<size_t>(stride - read));
+        if (r < 0 && errno == EINTR) { continue; }
+        if (r <= 0) { return QImage(); }
+        read += static_cast<int>(r);
+      }
+      std::memcpy(image.scanLine(y), row.constData(), copyBytes);
+    }
+    return image;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QImage grabScreenDBusKde()
+  {
+    // KWin 5.23 and later: raw image data of all screens through a pipe, without any encoding
+    // or temporary file.
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) == 0)
+    {
+      QDBusInterface interface(QStringLiteral("org.kde.KWin"),
+                               QStringLiteral("/org/kde/KWin/ScreenShot2"),
+                               QStringLiteral("org.kde.KWin.ScreenShot2"));
+      const QVariantMap options{ {QStringLiteral("native-resolution"), true} };
+      QDBusReply<QVariantMap> reply = interface.call(QStringLiteral("CaptureWorkspace"), options,
+                                                     QVariant::fromValue(QDBusUnixFileDescriptor(fds[1])));
+      ::close(fds[1]); // the descriptor was duplicated for the call, KWin closes its copy when done
+      const QImage image = reply.isValid() ? readRawImage(fds[0], reply.value()) : QImage();
+      ::close(fds[0]);
+      if (!image.isNull()) { return image; }
+    }
+
     QDBusInterface interface(QStringLiteral("org.kde.KWin"),
                              QStringLiteral("/Screenshot"),
                              QStringLiteral("org.kde.kwin.Screenshot"));
     QDBusReply<QString> reply = interface.call(QStringLiteral("screenshotFullscreen"));
-    QPixmap pm(reply.value());
-    if (!pm.isNull()) {
+    const QImage image(reply.value());
+    if (!image.isNull()) {
       QFile::remove(reply.value());
     } else {
       logError(desktop) << LinuxDesktop::tr("Screenshot via KDE DBus interface failed.");
     }
-    return pm;
+    return image;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QImage grabScreenDBus(LinuxDesktop::Type type)
+  {
+    switch (type)
+    {
+    case LinuxDesktop::Type::Gnome: return grabScreenDBusGnome();
+    case LinuxDesktop::Type::KDE: return grabScreenDBusKde();
+    default:
+      logWarning(desktop) << LinuxDesktop::tr("Currently zoom on Wayland is only supported via DBus on KDE and GNOME.");
+    }
+    return QImage();
   }
 #endif // HAS_Qt_DBus
 
   // -----------------------------------------------------------------------------------------------
-  QPixmap grabScreenVirtualDesktop(QScreen* screen)
+  QRect virtualDesktopGeometry()
   {
     QRect g;
     for (const auto s : QGuiApplication::screens()) {
       g = g.united(s->geometry());
     }
+    return g;
+  }
 
+  // -----------------------------------------------------------------------------------------------
+  QImage grabVirtualDesktop(const QRect& g)
+  {
     #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
-    QPixmap pm(QApplication::primaryScreen()->grabWindow(
-                 QApplication::desktop()->winId(), g.x(), g.y(), g.width(), g.height()));
+    return QApplication::primaryScreen()->grabWindow(
+             QApplication::desktop()->winId(), g.x(), g.y(), g.width(), g.height()).toImage();
     #else
-    QPixmap pm(QApplication::primaryScreen()->grabWindow(0, g.x(), g.y(), g.width(), g.height()));
+    return QApplication::primaryScreen()->grabWindow(0, g.x(), g.y(), g.width(), g.height()).toImage();
     #endif
-
-    if (!pm.isNull())
-    {
-      pm.setDevicePixelRatio(screen->devicePixelRatio());
-      return pm.copy(screen->geometry());
-    }
-
-    return pm;
   }
 } // end anonymous namespace
 
+// -------------------------------------------------------------------------------------------------
 LinuxDesktop::LinuxDesktop(QObject* parent)
   : QObject(parent)
 {
@@ -109,50 +189,110 @@ LinuxDesktop::LinuxDesktop(QObject* parent)
   }
 }
 
-QPixmap LinuxDesktop::grabScreen(QScreen* screen) const
+// -------------------------------------------------------------------------------------------------
+QRect LinuxDesktop::DesktopGrab::areaRect(const QRect& area) const
 {
-  if (screen == nullptr) {
-    return QPixmap();
-  }
+  if (image.isNull() || geometry.isEmpty() || area.isEmpty()) { return QRect(); }
 
-  if (isWayland()) {
-    return grabScreenWayland(screen);
-  }
+  // Captures are usually in device pixels, the geometry is in device independent pixels.
+  const qreal sx = qreal(image.width()) / geometry.width();
+  const qreal sy = qreal(image.height()) / geometry.height();
+  const QRect r = area.translated(-geometry.topLeft());
+  return QRect(qRound(r.x() * sx), qRound(r.y() * sy),
+               qRound(r.width() * sx), qRound(r.height() * sy)).intersected(image.rect());
+}
+
+// -------------------------------------------------------------------------------------------------
+QRect LinuxDesktop::DesktopGrab::screenRect(const QScreen* screen) const
+{
+  return screen ? areaRect(screen->geometry()) : QRect();
+}
 
+// -------------------------------------------------------------------------------------------------
+QImage LinuxDesktop::DesktopGrab::screenImage(const QScreen* screen) const
+{
+  return screen ? areaImage(screen->geometry()) : QImage();
+}
+
+// -------------------------------------------------------------------------------------------------
+QImage LinuxDesktop::DesktopGrab::areaImage(const QRect& area) const
+{
+  const QRect pixels = areaRect(area);
+  if (pixels.isEmpty()) { return QImage(); }
+  if (pixels == image.rect()) { return image; }
+  if (image.depth() < 8) { return image.copy(pixels); }
+
+  // A view onto the pixels of the screen inside the capture, the capture is kept alive by the
+  // view's cleanup function; the pixel data is not copied.
+  const auto capture = new QImage(image);
+  const uchar* const bits = capture->constBits() + pixels.y() * capture->bytesPerLine()
+                            + pixels.x() * (capture->depth() / 8);
+  QImage view(bits, pixels.width(), pixels.height(), capture->bytesPerLine(), capture->format(),
+              [](void* info) { delete static_cast<QImage*>(info); }, capture);
+  view.setDevicePixelRatio(qreal(image.width()) / geometry.width());
+  return view;
+}
+
+// -------------------------------------------------------------------------------------------------
+LinuxDesktop::DesktopGrab LinuxDesktop::grabDesktop() const
+{
   #if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
     const bool isVirtualDesktop = QApplication::primaryScreen()->virtualSiblings().size() > 1;
   #else
     const bool isVirtualDesktop = QApplication::desktop()->isVirtualDesktop();
   #endif
 
-  if (isVirtualDesktop) {
-    return grabScreenVirtualDesktop(screen);
+  if (isVirtualDesktop)
+  {
+    const QRect g = virtualDesktopGeometry();
+    return DesktopGrab{ grabVirtualDesktop(g), g };
   }
 
   // everything else.. usually X11
-  return screen->grabWindow(0);
+  const auto screen = QApplication::primaryScreen();
+  if (!screen) { return DesktopGrab(); }
+  return DesktopGrab{ screen->grabWindow(0).toImage(), screen->geometry() };
 }
 
-QPixmap LinuxDesktop::grabScreenWayland(QScreen* screen) const
+// -------------------------------------------------------------------------------------------------
+void LinuxDesktop::grabDesktopAsync(QObject* context, GrabCallback callback) const
 {
-#if HAS_Qt_DBus
-  QPixmap pm;
-  switch (type())
+  QElapsedTimer timer;
+  timer.start();
+
+  if (isWayland())
   {
-  case LinuxDesktop::Type::Gnome:
-    pm = grabScreenDBusGnome();
-    break;
-  case LinuxDesktop::Type::KDE:
-    pm = grabScreenDBusKde();
-    break;
-  default:
+#if HAS_Qt_DBus
+    if (type() == Type::Gnome || type() == Type::KDE)
+    {
+      // DBus screenshots take a round trip through the compositor (and for GNOME a PNG file),
+      // don't block the GUI thread with that.
+      std::thread([type = type(), geometry = virtualDesktopGeometry(),
+                   context = QPointer<QObject>(context), callback = std::move(callback), timer]()
+      {
+        const DesktopGrab grab{ grabScreenDBus(type), geometry };
+        const auto app = QCoreApplication::instance();
+        if (!app) { return; }
+
+        async::invoke(app, [context, callback, grab, timer]()
+        {
+          logDebug(desktop) << tr("Screen capture took %1 ms.").arg(timer.elapsed());
+          if (context) { callback(grab); }
+        });
+      }).detach();
+      return;
+    }
     logWarning(desktop) << tr("Currently zoom on Wayland is only supported via DBus on KDE and GNOME.");
-  }
-  return pm.isNull() ? pm : pm.copy(screen->geometry());
 #else
-  Q_UNUSED(screen);
-  logWarning(desktop) << tr("Projecteur was compiled without Qt DBus. Currently zoom on Wayland is "
-                            "only supported via DBus on KDE and GNOME.");
-  return QPixmap();
+    logWarning(desktop) << tr("Projecteur was compiled without Qt DBus. Currently zoom on Wayland is "
+                              "only supported via DBus on KDE and GNOME.");
 #endif
+    callback(DesktopGrab());
+    return;
+  }
+
+  // X11 grabs use the Qt platform plugin, which is only allowed on the GUI thread.
+  const auto grab = grabDesktop();
+  logDebug(desktop) << tr("Screen capture took %1 ms.").arg(timer.elapsed());
+  callback(grab);
 }
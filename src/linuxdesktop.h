@@ -2,8 +2,11 @@
 // - See LICENSE.md and README.md
 #pragma once
 
+#include <QImage>
 #include <QObject>
-#include <QPixmap>
+#include <QRect>
+
+#include <functional>
 
 class QScreen;
 
@@ -19,11 +22,31 @@ public:
   bool isWayland() const { return m_wayland; };
   Type type() const { return m_type; };
 
-  QPixmap grabScreen(QScreen* screen) const;
+  /// Content of all screens from a single capture.
+  struct DesktopGrab
+  {
+    QImage image;   ///< Null if the desktop could not be grabbed.
+    QRect geometry; ///< Captured area in global (device independent) coordinates.
+
+    /// Pixel rectangle of the given area (global coordinates) inside image.
+    QRect areaRect(const QRect& area) const;
+    /// Part of the capture showing the given area, shares the pixel data with image.
+    QImage areaImage(const QRect& area) const;
+    /// Pixel rectangle of the given screen inside image.
+    QRect screenRect(const QScreen* screen) const;
+    /// Part of the capture showing the given screen, shares the pixel data with image.
+    QImage screenImage(const QScreen* screen) const;
+  };
+
+  using GrabCallback = std::function<void(const DesktopGrab&)>;
+  /// Grab the desktop without blocking the GUI thread where possible: on Wayland the DBus
+  /// screenshot is taken on a worker thread and the callback is invoked later on the GUI thread
+  /// (not at all if context was deleted); otherwise the callback is invoked right away.
+  void grabDesktopAsync(QObject* context, GrabCallback callback) const;
 
 private:
   bool m_wayland = false;
   Type m_type = Type::Other;
 
-  QPixmap grabScreenWayland(QScreen* screen) const;
+  DesktopGrab grabDesktop() const;
 };
\ No newline at end of file
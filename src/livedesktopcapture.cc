@@ -0,0 +1,612 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+
+#include "livedesktopcapture.h"
+
+#include "asynchronous.h"
+#include "logging.h"
+
+#include <QGuiApplication>
+#include <QPainter>
+#include <QRegion>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if HAS_Xcb_Damage
+#include <xcb/composite.h>
+#include <xcb/damage.h>
+#include <xcb/shm.h>
+#include <xcb/xcb.h>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <algorithm>
+#include <cstdlib>
+#endif
+
+DECLARE_LOGGING_CATEGORY(desktop)
+
+#if HAS_Xcb_Damage
+namespace {
+  // -----------------------------------------------------------------------------------------------
+  template<typename T>
+  std::unique_ptr<T, decltype(&std::free)> xcbReply(T* reply) {
+    return std::unique_ptr<T, decltype(&std::free)>(reply, &std::free);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Top level window (child of the root window) that is part of the capture.
+  struct TopLevel
+  {
+    xcb_window_t window = XCB_NONE;
+    QRect rect;        ///< Window area (without border) in root window coordinates
+    bool argb = false; ///< Window with alpha channel, blended with the windows below
+    xcb_damage_damage_t damage = XCB_NONE;
+    bool damaged = false;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  /// X connection of the live capture worker thread: window tracking, damage and reading back
+  /// window content.
+  class XcbCapture
+  {
+  public:
+    XcbCapture() = default;
+    XcbCapture(const XcbCapture&) = delete;
+    XcbCapture& operator=(const XcbCapture&) = delete;
+    ~XcbCapture();
+
+    /// Returns an error message if live capture is not possible.
+    QString init(const std::vector<WId>& excludedWindows, const QRect& area);
+
+    /// Handle pending X events, returns the damaged region in root window coordinates.
+    QRegion processEvents();
+
+    /// Read the content of rect (root window coordinates) from the top level windows into
+    /// frame, where origin is the root window position of the frame's top left pixel.
+    void compose(const QRect& rect, QImage& frame, const QPoint& origin);
+
+  private:
+    void updateTopLevels(QRegion& damaged);
+    QImage readImage(const TopLevel& topLevel, const QRect& rect);
+    void initShm(const QRect& area);
+
+    xcb_connection_t* m_connection = nullptr;
+    xcb_window_t m_root = XCB_NONE;
+    xcb_window_t m_overlayWindow = XCB_NONE; // composite overlay window of the compositing manager
+    uint8_t m_damageNotify = 0;
+    std::vector<xcb_window_t> m_excluded;
+    std::vector<TopLevel> m_topLevels; // bottom to top
+
+    xcb_shm_seg_t m_shmSegment = XCB_NONE;
+    void* m_shmData = nullptr;
+    size_t m_shmSize = 0;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  XcbCapture::~XcbCapture()
+  {
+    if (!m_connection) { return; }
+
+    if (m_shmSegment != XCB_NONE) { xcb_shm_detach(m_connection, m_shmSegment); }
+    if (m_shmData) { ::shmdt(m_shmData); }
+    // Damage objects are freed by the server with the connection.
+    xcb_disconnect(m_connection);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QString XcbCapture::init(const std::vector<WId>& excludedWindows, const QRect& area)
+  {
+    int screenNumber = 0;
+    m_connection = xcb_connect(nullptr, &screenNumber);
+    if (xcb_connection_has_error(m_connection)) {
+      return LiveDesktopCapture::tr("Cannot connect to the X server.");
+    }
+
+    const xcb_setup_t* setup = xcb_get_setup(m_connection);
+    auto screenIt = xcb_setup_roots_iterator(setup);
+    for (int i = 0; i < screenNumber && screenIt.rem; ++i) { xcb_screen_next(&screenIt); }
+    if (!screenIt.rem) { return LiveDesktopCapture::tr("X screen not found."); }
+    m_root = screenIt.data->root;
+
+    // Window content is copied as 32 bit BGRA/BGRX, i.e. QImage::Format_(A)RGB32.
+    if (setup->image_byte_order != XCB_IMAGE_ORDER_LSB_FIRST) {
+      return LiveDesktopCapture::tr("Unsupported X server image byte order.");
+    }
+    const xcb_format_t* formats = xcb_setup_pixmap_formats(setup);
+    for (int i = 0; i < xcb_setup_pixmap_formats_length(setup); ++i)
+    {
+      if ((formats[i].depth == 24 || formats[i].depth == 32) && formats[i].bits_per_pixel != 32) {
+        return LiveDesktopCapture::tr("Unsupported X server pixel format.");
+      }
+    }
+
+    // Without a compositing manager the content of obscured windows cannot be read.
+    const QByteArray cmSelection = QString("_NET_WM_CM_S%1").arg(screenNumber).toLatin1();
+    const auto atom = xcbReply(xcb_intern_atom_reply(m_connection,
+      xcb_intern_atom(m_connection, 0, static_cast<uint16_t>(cmSelection.size()), cmSelection.constData()),
+      nullptr));
+    const auto owner = atom ? xcbReply(xcb_get_selection_owner_reply(m_connection,
+                                xcb_get_selection_owner(m_connection, atom->atom), nullptr))
+                            : xcbReply<xcb_get_selection_owner_reply_t>(nullptr);
+    if (!owner || owner->owner == XCB_NONE) {
+      return LiveDesktopCapture::tr("No compositing manager running.");
+    }
+
+    const auto damageExtension = xcb_get_extension_data(m_connection, &xcb_damage_id);
+    const auto damageVersion = (damageExtension && damageExtension->present)
+      ? xcbReply(xcb_damage_query_version_reply(m_connection,
+          xcb_damage_query_version(m_connection, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION),
+          nullptr))
+      : xcbReply<xcb_damage_query_version_reply_t>(nullptr);
+    if (!damageVersion) {
+      return LiveDesktopCapture::tr("X server DAMAGE extension not available.");
+    }
+    m_damageNotify = damageExtension->first_event + XCB_DAMAGE_NOTIFY;
+
+    // The composite overlay window is a child of the root window and shows everything,
+    // including the overlay windows. Asking for it increments a reference count, it is
+    // released again right away, the compositing manager holds its own reference.
+    const auto compositeExtension = xcb_get_extension_data(m_connection, &xcb_composite_id);
+    if (compositeExtension && compositeExtension->present
+        && xcbReply(xcb_composite_query_version_reply(m_connection,
+             xcb_composite_query_version(m_connection, 0, 3), nullptr)))
+    {
+      if (const auto overlay = xcbReply(xcb_composite_get_overlay_window_reply(m_connection,
+                                 xcb_composite_get_overlay_window(m_connection, m_root), nullptr)))
+      {
+        m_overlayWindow = overlay->overlay_win;
+        xcb_composite_release_overlay_window(m_connection, m_root);
+      }
+    }
+
+    m_excluded.reserve(excludedWindows.size());
+    for (const auto w : excludedWindows) { m_excluded.push_back(static_cast<xcb_window_t>(w)); }
+
+    initShm(area);
+
+    const uint32_t eventMask[] = { XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY };
+    xcb_change_window_attributes(m_connection, m_root, XCB_CW_EVENT_MASK, eventMask);
+
+    QRegion ignored;
+    updateTopLevels(ignored);
+    xcb_flush(m_connection);
+    return QString();
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  void XcbCapture::initShm(const QRect& area)
+  {
+    const auto shmExtension = xcb_get_extension_data(m_connection, &xcb_shm_id);
+    if (!shmExtension || !shmExtension->present
+        || !xcbReply(xcb_shm_query_version_reply(m_connection, xcb_shm_query_version(m_connection),
+                                                 nullptr))) {
+      return;
+    }
+
+    // Large enough for the complete area, damaged rectangles are clipped to it.
+    const size_t size = static_cast<size_t>(area.width()) * static_cast<size_t>(area.height()) * 4;
+    const int shmId = ::shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (shmId < 0) { return; }
+
+    void* data = ::shmat(shmId, nullptr, 0);
+    if (data != reinterpret_cast<void*>(-1))
+    {
+      const auto segment = xcb_generate_id(m_connection);
+      const auto error = xcbReply(xcb_request_check(m_connection,
+                           xcb_shm_attach_checked(m_connection, segment, static_cast<uint32_t>(shmId), 0)));
+      if (!error) {
+        m_shmSegment = segment;
+        m_shmData = data;
+        m_shmSize = size;
+      } else {
+        ::shmdt(data); // e.g. remote X server
+      }
+    }
+    // Attached segments stay valid until they are detached.
+    ::shmctl(shmId, IPC_RMID, nullptr);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  void XcbCapture::updateTopLevels(QRegion& damaged)
+  {
+    const auto tree = xcbReply(xcb_query_tree_reply(m_connection,
+                                                    xcb_query_tree(m_connection, m_root), nullptr));
+    if (!tree) { return; }
+
+    const xcb_window_t* children = xcb_query_tree_children(tree.get());
+    const int numChildren = xcb_query_tree_children_length(tree.get());
+
+    struct Cookies {
+      xcb_window_t window;
+      xcb_get_window_attributes_cookie_t attributes;
+      xcb_get_geometry_cookie_t geometry;
+    };
+    std::vector<Cookies> cookies;
+    cookies.reserve(static_cast<size_t>(numChildren));
+    for (int i = 0; i < numChildren; ++i)
+    {
+      const xcb_window_t w = children[i];
+      if (w == m_overlayWindow || std::find(m_excluded.cbegin(), m_excluded.cend(), w) != m_excluded.cend()) {
+        continue;
+      }
+      cookies.push_back({w, xcb_get_window_attributes(m_connection, w), xcb_get_geometry(m_connection, w)});
+    }
+
+    std::vector<TopLevel> topLevels;
+    topLevels.reserve(cookies.size());
+    for (const auto& c : cookies)
+    {
+      const auto attributes = xcbReply(xcb_get_window_attributes_reply(m_connection, c.attributes, nullptr));
+      const auto geometry = xcbReply(xcb_get_geometry_reply(m_connection, c.geometry, nullptr));
+      if (!attributes || !geometry
+          || attributes->map_state != XCB_MAP_STATE_VIEWABLE
+          || attributes->_class != XCB_WINDOW_CLASS_INPUT_OUTPUT
+          || (geometry->depth != 24 && geometry->depth != 32)) {
+        continue;
+      }
+
+      TopLevel t;
+      t.window = c.window;
+      t.rect = QRect(geometry->x + geometry->border_width, geometry->y + geometry->border_width,
+                     geometry->width, geometry->height);
+      t.argb = geometry->depth == 32;
+      topLevels.push_back(t);
+    }
+
+    // Previous stacking order of the windows that are still there.
+    std::vector<xcb_window_t> windows;
+    windows.reserve(topLevels.size());
+    for (const auto& t : topLevels) { windows.push_back(t.window); }
+    std::sort(windows.begin(), windows.end());
+    std::vector<xcb_window_t> previousOrder;
+    for (const auto& t : m_topLevels) {
+      if (std::binary_search(windows.cbegin(), windows.cend(), t.window)) { previousOrder.push_back(t.window); }
+    }
+
+    // Keep the damage objects of known windows and damage everything that was moved, resized,
+    // restacked, mapped or unmapped.
+    size_t common = 0;
+    for (auto& t : topLevels)
+    {
+      const auto it = std::find_if(m_topLevels.begin(), m_topLevels.end(),
+                                   [&t](const TopLevel& o) { return o.window == t.window; });
+      if (it == m_topLevels.end())
+      {
+        t.damage = xcb_generate_id(m_connection);
+        xcb_damage_create(m_connection, t.damage, t.window, XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX);
+        damaged += t.rect;
+        continue;
+      }
+
+      t.damage = it->damage;
+      t.damaged = it->damaged;
+      it->damage = XCB_NONE;
+      if (it->rect != t.rect || previousOrder[common] != t.window) {
+        damaged += it->rect;
+        damaged += t.rect;
+      }
+      ++common;
+    }
+
+    for (const auto& t : m_topLevels)
+    {
+      if (t.damage == XCB_NONE) { continue; }
+      damaged += t.rect;
+      // Fails with BadDamage for destroyed windows, errors are ignored.
+      xcb_damage_destroy(m_connection, t.damage);
+    }
+
+    m_topLevels.swap(topLevels);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QRegion XcbCapture::processEvents()
+  {
+    QRegion damaged;
+    bool structureChanged = false;
+
+    while (const auto event = xcbReply(xcb_poll_for_event(m_connection)))
+    {
+      const uint8_t type = event->response_type & ~0x80;
+      if (type == m_damageNotify)
+      {
+        const auto notify = reinterpret_cast<const xcb_damage_notify_event_t*>(event.get());
+        const auto it = std::find_if(m_topLevels.begin(), m_topLevels.end(),
+                                     [notify](const TopLevel& t) { return t.damage == notify->damage; });
+        if (it == m_topLevels.end()) { continue; }
+        damaged += QRect(notify->area.x, notify->area.y, notify->area.width, notify->area.height)
+                     .translated(it->rect.topLeft());
+        it->damaged = true;
+        continue;
+      }
+
+      switch (type)
+      {
+      case XCB_DESTROY_NOTIFY:
+      case XCB_UNMAP_NOTIFY:
+      case XCB_MAP_NOTIFY:
+      case XCB_REPARENT_NOTIFY:
+      case XCB_CONFIGURE_NOTIFY:
+      case XCB_GRAVITY_NOTIFY:
+      case XCB_CIRCULATE_NOTIFY:
+        structureChanged = true;
+        break;
+      default: // errors (type 0) and everything else
+        break;
+      }
+    }
+
+    if (structureChanged) { updateTopLevels(damaged); }
+
+    // Reset the damage before reading the windows, new damage creates new events.
+    for (auto& t : m_topLevels)
+    {
+      if (!t.damaged) { continue; }
+      xcb_damage_subtract(m_connection, t.damage, XCB_NONE, XCB_NONE);
+      t.damaged = false;
+    }
+    xcb_flush(m_connection);
+    return damaged;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  // Returns an image with the pixels of rect (window coordinates), only valid until the next call.
+  QImage XcbCapture::readImage(const TopLevel& topLevel, const QRect& rect)
+  {
+    const auto format = topLevel.argb ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    const auto x = static_cast<int16_t>(rect.x());
+    const auto y = static_cast<int16_t>(rect.y());
+    const auto width = static_cast<uint16_t>(rect.width());
+    const auto height = static_cast<uint16_t>(rect.height());
+
+    if (m_shmData && static_cast<size_t>(rect.width()) * static_cast<size_t>(rect.height()) * 4 <= m_shmSize)
+    {
+      xcb_generic_error_t* error = nullptr;
+      const auto reply = xcbReply(xcb_shm_get_image_reply(m_connection,
+        xcb_shm_get_image(m_connection, topLevel.window, x, y, width, height, ~0u,
+                          XCB_IMAGE_FORMAT_Z_PIXMAP, m_shmSegment, 0), &error));
+      std::free(error);
+      if (!reply) { return QImage(); }
+      return QImage(static_cast<const uchar*>(m_shmData), rect.width(), rect.height(),
+                    rect.width() * 4, format);
+    }
+
+    xcb_generic_error_t* error = nullptr;
+    auto reply = xcb_get_image_reply(m_connection,
+                   xcb_get_image(m_connection, XCB_IMAGE_FORMAT_Z_PIXMAP, topLevel.window,
+                                 x, y, width, height, ~0u), &error);
+    std::free(error);
+    if (!reply) { return QImage(); }
+    if (xcb_get_image_data_length(reply) < rect.width() * rect.height() * 4) {
+      std::free(reply);
+      return QImage();
+    }
+    return QImage(xcb_get_image_data(reply), rect.width(), rect.height(), rect.width() * 4, format,
+                  [](void* info) { std::free(info); }, reply);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  void XcbCapture::compose(const QRect& rect, QImage& frame, const QPoint& origin)
+  {
+    // Windows below the top most opaque window that covers the whole rect are not visible.
+    size_t first = 0;
+    for (size_t i = m_topLevels.size(); i-- > 0; )
+    {
+      if (!m_topLevels[i].argb && m_topLevels[i].rect.contains(rect)) {
+        first = i;
+        break;
+      }
+    }
+
+    for (size_t i = first; i < m_topLevels.size(); ++i)
+    {
+      const auto& t = m_topLevels[i];
+      const QRect r = t.rect.intersected(rect);
+      if (r.isEmpty()) { continue; }
+
+      const QImage image = readImage(t, r.translated(-t.rect.topLeft()));
+      if (image.isNull()) { continue; }
+
+      const QPoint p = r.topLeft() - origin;
+      if (t.argb)
+      {
+        QPainter painter(&frame);
+        painter.drawImage(p, image);
+        continue;
+      }
+
+      // The unused byte of depth 24 pixels is not necessarily 0xff.
+      for (int y = 0; y < image.height(); ++y)
+      {
+        const auto src = reinterpret_cast<const quint32*>(image.constScanLine(y));
+        const auto dst = reinterpret_cast<quint32*>(frame.scanLine(p.y() + y)) + p.x();
+        for (int x = 0; x < image.width(); ++x) { dst[x] = src[x] | 0xff000000u; }
+      }
+    }
+  }
+} // end anonymous namespace
+#endif // HAS_Xcb_Damage
+
+// -------------------------------------------------------------------------------------------------
+struct LiveDesktopCapture::Worker
+{
+  Worker(LiveDesktopCapture* owner, quint64 generation, const QImage& image, const QPoint& origin,
+         const std::vector<WId>& excludedWindows, int intervalMs)
+    : owner(owner), generation(generation)
+    , frame(image.convertToFormat(QImage::Format_RGB32)), origin(origin)
+    , excludedWindows(excludedWindows), intervalMs(intervalMs)
+  {
+    frame.setDevicePixelRatio(1.0); // painted with pixel coordinates
+    thread = std::thread([this](){ run(); });
+  }
+
+  ~Worker() { finish(); }
+
+  void finish()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopRequested = true;
+    }
+    condition.notify_all();
+    if (thread.joinable()) { thread.join(); }
+  }
+
+  void setInterval(int ms)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      intervalMs = ms;
+    }
+    condition.notify_all();
+  }
+
+  void run();
+
+  LiveDesktopCapture* const owner;
+  const quint64 generation;
+  QImage frame;        // only accessed by the worker thread
+  const QPoint origin; // root window position of the top left pixel of frame
+  const std::vector<WId> excludedWindows;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopRequested = false;
+  int intervalMs;
+
+  // Statistics, read after the thread has finished.
+  quint64 updates = 0;
+  quint64 pixels = 0;
+
+  std::thread thread;
+};
+
+// -------------------------------------------------------------------------------------------------
+void LiveDesktopCapture::Worker::run()
+{
+#if HAS_Xcb_Damage
+  const QRect area(origin, frame.size());
+  XcbCapture capture;
+  const QString error = capture.init(excludedWindows, area);
+  if (!error.isEmpty())
+  {
+    async::invoke(owner, [error]() {
+      logWarning(desktop) << LiveDesktopCapture::tr("Live zoom not available: %1").arg(error);
+    });
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopRequested)
+  {
+    condition.wait_for(lock, std::chrono::milliseconds(intervalMs), [this]() { return stopRequested; });
+    if (stopRequested) { break; }
+    lock.unlock();
+
+    QRegion damaged = capture.processEvents() & area;
+    // Many small rectangles cost more round trips than the pixels around them.
+    if (damaged.rectCount() > 16) { damaged = damaged.boundingRect(); }
+
+    Patches patches;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    for (const QRect& r : damaged)
+#else
+    for (const QRect& r : damaged.rects())
+#endif
+    {
+      capture.compose(r, frame, origin);
+      const QRect pixelRect = r.translated(-origin);
+      patches.push_back(Patch{ frame.copy(pixelRect), pixelRect.topLeft() });
+      pixels += static_cast<quint64>(r.width()) * static_cast<quint64>(r.height());
+    }
+
+    if (!patches.isEmpty())
+    {
+      ++updates;
+      async::invoke(owner, [owner = owner, generation = generation, patches = std::move(patches)]() {
+        if (owner->m_generation == generation) { emit owner->updated(patches); }
+      });
+    }
+    lock.lock();
+  }
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+LiveDesktopCapture::LiveDesktopCapture(QObject* parent)
+  : QObject(parent)
+{}
+
+// -------------------------------------------------------------------------------------------------
+LiveDesktopCapture::~LiveDesktopCapture()
+{
+  stop();
+}
+
+// -------------------------------------------------------------------------------------------------
+bool LiveDesktopCapture::isSupported()
+{
+#if HAS_Xcb_Damage
+  return QGuiApplication::platformName() == QLatin1String("xcb");
+#else
+  return false;
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+bool LiveDesktopCapture::start(const LinuxDesktop::DesktopGrab& grab, int rate,
+                               const std::vector<WId>& excludedWindows)
+{
+  stop();
+  if (rate <= 0 || grab.image.isNull() || grab.geometry.isEmpty()) { return false; }
+
+  if (!isSupported())
+  {
+#if HAS_Xcb_Damage
+    logWarning(desktop) << tr("Live zoom is only supported on X11.");
+#else
+    logWarning(desktop) << tr("Projecteur was compiled without xcb damage and shm support, "
+                              "live zoom is not available.");
+#endif
+    return false;
+  }
+
+  // X11 root window coordinates are device pixels, just like the grab.
+  const qreal sx = qreal(grab.image.width()) / grab.geometry.width();
+  const qreal sy = qreal(grab.image.height()) / grab.geometry.height();
+  const QPoint origin(qRound(grab.geometry.x() * sx), qRound(grab.geometry.y() * sy));
+
+  m_worker = std::make_unique<Worker>(this, ++m_generation, grab.image, origin, excludedWindows,
+                                      1000 / rate);
+  return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void LiveDesktopCapture::stop()
+{
+  if (!m_worker) { return; }
+
+  ++m_generation; // updates still in the event queue are dropped
+  const auto worker = std::move(m_worker);
+  worker->finish();
+
+  if (worker->updates > 0)
+  {
+    const qreal area = qreal(worker->frame.width()) * worker->frame.height();
+    logDebug(desktop) << tr("Live zoom: %1 updates, each updated %2 % of the desktop on average.")
+                         .arg(worker->updates).arg(100.0 * worker->pixels / worker->updates / area, 0, 'f', 2);
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void LiveDesktopCapture::setRate(int rate)
+{
+  if (!m_worker) { return; }
+  if (rate <= 0) { stop(); return; }
+  m_worker->setInterval(1000 / rate);
+}
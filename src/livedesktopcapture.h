@@ -0,0 +1,56 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+#pragma once
+
+#include "linuxdesktop.h"
+
+#include <QImage>
+#include <QObject>
+#include <QPoint>
+#include <QVector>
+#include <QWindow>
+
+#include <memory>
+#include <vector>
+
+/// Keeps a desktop grab up to date while the spotlight is shown (live zoom).
+///
+/// On X11 a worker thread with its own X connection tracks the damage of all top level windows
+/// (DAMAGE extension) and reads back only the damaged areas, via MIT-SHM if available. The areas
+/// are read from the top level windows themselves and not from the root window, so the overlay
+/// windows never end up in the capture. Reading obscured window content requires a running
+/// compositing manager, which the translucent overlay needs anyway.
+class LiveDesktopCapture : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// Updated part of the desktop grab.
+  struct Patch
+  {
+    QImage image;
+    QPoint position; ///< Pixel position inside the image of the desktop grab.
+  };
+  using Patches = QVector<Patch>;
+
+  explicit LiveDesktopCapture(QObject* parent = nullptr);
+  ~LiveDesktopCapture() override;
+
+  /// True if live capture is available with this build and Qt platform.
+  static bool isSupported();
+
+  /// Start updating the given grab with the given number of updates per second. The windows
+  /// in excludedWindows are left out. A running capture is stopped first.
+  bool start(const LinuxDesktop::DesktopGrab& grab, int rate, const std::vector<WId>& excludedWindows);
+  void stop();
+  bool isActive() const { return m_worker != nullptr; }
+  void setRate(int rate);
+
+signals:
+  void updated(const LiveDesktopCapture::Patches& patches);
+
+private:
+  struct Worker;
+  std::unique_ptr<Worker> m_worker;
+  quint64 m_generation = 0; // updates of older workers are dropped
+};
@@ -11,6 +11,7 @@
 #include <QString>
 
 #include <iostream>
+#include <mutex>
 
 namespace {
   // -----------------------------------------------------------------------------------------------
@@ -78,9 +79,13 @@ namespace {
   }
 
   // -----------------------------------------------------------------------------------------------
+  // Log messages are also written from worker threads, output and text edit cache are guarded.
+  std::recursive_mutex logMutex; // recursive, invoking the text edit may log itself
   QPointer<QPlainTextEdit> logPlainTextEdit;
   QMetaMethod logAppendMetaMethod;
-  QList<QString> logPlainTextCache; // log messages are stored here until a text edit is registered
+  // The latest log messages, shown when a text edit is registered. The preferences dialog with
+  // the text edit is created on demand and can be destroyed and created again.
+  QList<QString> logPlainTextCache;
   constexpr int logPlainTextCacheMax = 1000;
 
   // -----------------------------------------------------------------------------------------------
@@ -88,9 +93,11 @@ namespace {
   {
     if (logPlainTextEdit) {
       logAppendMetaMethod.invoke(logPlainTextEdit, Qt::QueuedConnection, Q_ARG(QString, logMsg));
-    } else if (logPlainTextCache.size() < logPlainTextCacheMax) {
-      logPlainTextCache.push_back(logMsg);
     }
+    if (logPlainTextCache.size() >= logPlainTextCacheMax) {
+      logPlainTextCache.pop_front();
+    }
+    logPlainTextCache.push_back(logMsg);
   }
 
   // -----------------------------------------------------------------------------------------------
@@ -106,8 +113,6 @@ namespace {
   }
 
   // -----------------------------------------------------------------------------------------------
-  // Currently all logging is done from within the Qt Gui thread
-  // - if that changes and multiple threads will log, this needs a serious overhaul - NOT thread safe
   void projecteurLogHandler(QtMsgType type, const QMessageLogContext &context, const QString &msgQString)
   {
     const char *category = context.category ? context.category : "";
@@ -121,6 +126,7 @@ namespace {
     const auto logMsg = QString("[%1][%2][%3] %4").arg(QDateTime::currentDateTime().toString(dateFormat),
                                                        typeToShortString(type), category, msgQString);
 
+    const std::lock_guard<std::recursive_mutex> lock(logMutex);
     if (type == QtDebugMsg || type == QtInfoMsg) {
       std::cout << qUtf8Printable(logMsg) << std::endl;
     } else {
@@ -134,6 +140,7 @@ namespace {
 namespace logging {
   void registerTextEdit(QPlainTextEdit* textEdit)
   {
+    const std::lock_guard<std::recursive_mutex> lock(logMutex);
     logPlainTextEdit = textEdit;
     if (!logPlainTextEdit) { return; }
 
@@ -143,8 +150,6 @@ namespace logging {
     for (const auto& logMsg : logPlainTextCache) {
       logAppendMetaMethod.invoke(logPlainTextEdit, Qt::QueuedConnection, Q_ARG(QString, logMsg));
     }
-
-    logPlainTextCache.clear();
   }
 
   const char* levelToString(level lvl)
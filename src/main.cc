@@ -17,6 +17,7 @@
 #include <csignal>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 
 #define XSTRINGIFY(s) STRINGIFY(s)
 #define STRINGIFY(x) #x
@@ -28,6 +29,7 @@ namespace {
   constexpr int PROJECTEUR_ERROR_ANOTHER_INST_RUNNING = 42;
   constexpr int PROJECTEUR_ERROR_NO_INSTANCE_FOUND = 43;
   constexpr int PROJECTEUR_ERROR_EMPTY_COMMAND_PROPS = 44;
+  constexpr int PROJECTEUR_ERROR_PRECOMPILE_FAILED = 45;
 
   // -----------------------------------------------------------------------------------------------
   class Main : public QObject {};
@@ -203,6 +205,7 @@ namespace {
     const QCommandLineOption showDlgOnStartOption_ = {QStringList{ "show-dialog" }, Main::tr("Show preferences dialog on start.")};
     const QCommandLineOption dialogMinOnlyOption_ = {QStringList{ "m", "minimize-only" }, Main::tr("Only allow minimizing the dialog.")};
     const QCommandLineOption disableOverlayOption_ = {QStringList{ "disable-overlay" }, Main::tr("Disable spotlight overlay completely.")};
+    const QCommandLineOption precompileOption_ = {QStringList{ "precompile-input-maps" }, Main::tr("Write the input map stores of the config file and exit.")};
     const QCommandLineOption additionalDeviceOption_ = {QStringList{ "D", "additional-device"},
                                Main::tr("Additional accepted device; DEVICE = vendorId:productId\n"
                                         "                         "
@@ -215,7 +218,7 @@ namespace {
       parser.addOptions({versionOption_, helpOption_, fullHelpOption_, commandOption_,
                         cfgFileOption_, fullVersionOption_, deviceInfoOption_, logLvlOption_,
                         disableUInputOption_, showDlgOnStartOption_, dialogMinOnlyOption_,
-                        disableOverlayOption_, additionalDeviceOption_});
+                        disableOverlayOption_, additionalDeviceOption_, precompileOption_});
     }
 
     // ---------------------------------------------------------------------------------------------
@@ -231,6 +234,7 @@ namespace {
     bool showDlgOnStartOptionSet() const { return parser.isSet(showDlgOnStartOption_); }
     bool dialogMinOnlyOptionSet() const { return parser.isSet(dialogMinOnlyOption_); }
     bool disableOverlayOptionSet() const { return parser.isSet(disableOverlayOption_); }
+    bool precompileOptionSet() const { return parser.isSet(precompileOption_); }
     auto commandOptionValues() const { return parser.values(commandOption_); }
     bool cfgFileOptionSet() const { return parser.isSet(cfgFileOption_); }
     auto cfgFileOptionValue() const { return parser.value(cfgFileOption_); }
@@ -283,6 +287,8 @@ namespace {
         print() << "  --disable-uinput       " << disableUInputOption_.description();
         print() << "  --show-dialog          " << showDlgOnStartOption_.description();
         print() << "  -m, --minimize-only    " << dialogMinOnlyOption_.description();
+        print() << "  --precompile-input-maps" << std::endl
+                << "                         " << precompileOption_.description();
       }
       print() << "  -c COMMAND|PROPERTY    " << commandOption_.description() << std::endl;
       print() << "<Commands>";
@@ -291,6 +297,7 @@ namespace {
         print() << "  preset=NAME              " << Main::tr("Set a preset.");
         print() << "  vibrate[=I[,L]]          " << Main::tr("Send vibrate command to device with intensity,length.");
         print() << "  spot.size.adjust=[+|-]N  " << Main::tr("Increase or decrease spot size by N.");
+        print() << "  stats[=reset]            " << Main::tr("Log startup and overlay frame timing statistics.");
       }
       print() << "  settings=[show|hide]     " << Main::tr("Show/hide preferences dialog.");
       if (fullHelp) {
@@ -397,6 +404,21 @@ int main(int argc, char *argv[])
         error() << Main::tr("Cannot set log level, unknown level: '%1'").arg(parser.logLvlOptionValue());
       }
     }
+
+    // Write the binary input map stores, e.g. when deploying a prepared config file
+    if (parser.precompileOptionSet())
+    {
+      QCoreApplication app(argc, argv);
+      const auto settings = options.configFile.isEmpty() ? std::make_unique<Settings>()
+                                                         : std::make_unique<Settings>(options.configFile);
+      const int count = settings->precompileInputMaps();
+      if (count < 0) {
+        error() << Main::tr("Cannot write input map stores.");
+        return PROJECTEUR_ERROR_PRECOMPILE_FAILED;
+      }
+      print() << Main::tr("%1 input map store(s) written.").arg(count);
+      return 0;
+    }
   }
 
   RunGuard guard(QCoreApplication::applicationName());
@@ -631,6 +631,20 @@ QGroupBox* PreferencesDialog::createZoomGroupBox(Settings* settings)
   connect(settings, &Settings::zoomFactorChanged, this, &PreferencesDialog::resetPresetCombo);
   zoomGrid->addWidget(new QLabel(tr("Zoom Level"), this), 0, 0);
   zoomGrid->addWidget(zoomLevelSb, 0, 1);
+
+  // live zoom update rate, not part of presets
+  const auto liveRateSb = new QSpinBox(this);
+  liveRateSb->setMaximum(settings->zoomLiveRateRange().max);
+  liveRateSb->setMinimum(settings->zoomLiveRateRange().min);
+  liveRateSb->setSpecialValueText(tr("Off"));
+  liveRateSb->setSuffix(tr(" fps"));
+  liveRateSb->setValue(settings->zoomLiveRate());
+  liveRateSb->setToolTip(tr("Keep the zoomed desktop up to date while the spot is shown (X11 only)."));
+  connect(liveRateSb, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+          settings, &Settings::setZoomLiveRate);
+  connect(settings, &Settings::zoomLiveRateChanged, liveRateSb, &QSpinBox::setValue);
+  zoomGrid->addWidget(new QLabel(tr("Live Update"), this), 1, 0);
+  zoomGrid->addWidget(liveRateSb, 1, 1);
   zoomGrid->setColumnStretch(1, 1);
   return zoomGroup;
 }
@@ -666,12 +680,50 @@ QGroupBox* PreferencesDialog::createCursorGroupBox(Settings* settings)
 // -------------------------------------------------------------------------------------------------
 QWidget* PreferencesDialog::createMultiScreenWidget(Settings* settings)
 {
-  const auto cb = new QCheckBox(tr("Enable multi-screen overlay"), this);
+  const auto widget = new QWidget(this);
+  const auto vbox = new QVBoxLayout(widget);
+  vbox->setContentsMargins(0, 0, 0, 0);
+
+  const auto cb = new QCheckBox(tr("Enable multi-screen overlay"), widget);
   cb->setChecked(settings->multiScreenOverlayEnabled());
   connect(cb, &QCheckBox::toggled, settings, &Settings::setMultiScreenOverlayEnabled);
   connect(settings, &Settings::multiScreenOverlayEnabledChanged, cb, &QCheckBox::setChecked);
   connect(settings, &Settings::multiScreenOverlayEnabledChanged, this, &PreferencesDialog::resetPresetCombo);
-  return cb;
+  vbox->addWidget(cb);
+
+  const auto spanningCb = new QCheckBox(tr("Use a single window for all screens"), widget);
+  spanningCb->setToolTip(tr("One overlay window covering all screens, if supported (X11)."));
+  spanningCb->setChecked(settings->spanningOverlayEnabled());
+  spanningCb->setEnabled(settings->multiScreenOverlayEnabled());
+  connect(spanningCb, &QCheckBox::toggled, settings, &Settings::setSpanningOverlayEnabled);
+  connect(settings, &Settings::spanningOverlayEnabledChanged, spanningCb, &QCheckBox::setChecked);
+  connect(settings, &Settings::multiScreenOverlayEnabledChanged, spanningCb, &QCheckBox::setEnabled);
+  vbox->addWidget(spanningCb);
+
+  const auto compactCb = new QCheckBox(tr("Compact overlay without shade"), widget);
+  compactCb->setToolTip(tr("Without shade the overlay only covers the spot and the rest of the "
+                           "desktop stays untouched and clickable, if supported (X11)."));
+  compactCb->setChecked(settings->compactOverlayEnabled());
+  connect(compactCb, &QCheckBox::toggled, settings, &Settings::setCompactOverlayEnabled);
+  connect(settings, &Settings::compactOverlayEnabledChanged, compactCb, &QCheckBox::setChecked);
+  vbox->addWidget(compactCb);
+
+  const auto idleHBox = new QHBoxLayout();
+  const auto idleSb = new QSpinBox(widget);
+  idleSb->setMaximum(settings->overlayIdleUnloadRange().max);
+  idleSb->setMinimum(settings->overlayIdleUnloadRange().min);
+  idleSb->setSpecialValueText(tr("Never"));
+  idleSb->setSuffix(tr(" min"));
+  idleSb->setValue(settings->overlayIdleUnload());
+  idleSb->setToolTip(tr("Release the overlay after the given idle time without connected devices, "
+                        "it is created again when a device connects or the spot is shown."));
+  connect(idleSb, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+          settings, &Settings::setOverlayIdleUnload);
+  connect(settings, &Settings::overlayIdleUnloadChanged, idleSb, &QSpinBox::setValue);
+  idleHBox->addWidget(new QLabel(tr("Unload overlay when idle"), widget));
+  idleHBox->addWidget(idleSb, 1);
+  vbox->addLayout(idleHBox);
+  return widget;
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -5,17 +5,21 @@
 
 #include "aboutdlg.h"
 #include "device-command-helper.h"
-#include "imageitem.h"
+#include "frametiming.h"
 #include "linuxdesktop.h"
+#include "livedesktopcapture.h"
 #include "logging.h"
 #include "preferencesdlg.h"
 #include "settings.h"
+#include "spotcontroller.h"
 #include "spotlight.h"
+#include "spotlightitem.h"
 
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
 #include <QDesktopWidget>
 #endif
 
+#include <QFile>
 #include <QFontDatabase>
 #include <QLocalServer>
 #include <QLocalSocket>
@@ -24,12 +28,18 @@
 #include <QPointer>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQmlIncubator>
 #include <QQmlProperty>
 #include <QQuickWindow>
+#include <QRegion>
 #include <QScreen>
 #include <QSystemTrayIcon>
 #include <QTimer>
 #include <QWindow>
+#include <QtMath>
+
+#include <algorithm>
+#include <functional>
 
 LOGGING_CATEGORY(mainapp, "mainapp")
 LOGGING_CATEGORY(cmdclient, "cmdclient")
@@ -39,8 +49,82 @@ namespace {
   QString localServerName() {
     return QCoreApplication::applicationName() + "_local_socket";
   }
+
+  // Overlay windows keep these flags while they are mapped, activating and deactivating the
+  // spot only changes Qt::WindowTransparentForInput (the input region on X11).
+  Qt::WindowFlags overlayWindowFlags() {
+    return Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::ToolTip;
+  }
+
+  // Resident set size of the process in KiB, -1 if not available.
+  qint64 residentMemoryKiB()
+  {
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) { return -1; }
+    for (QByteArray line = file.readLine(); !line.isEmpty(); line = file.readLine())
+    {
+      if (line.startsWith("VmRSS:")) {
+        return line.mid(6).simplified().split(' ').value(0).toLongLong();
+      }
+    }
+    return -1;
+  }
+
+  QString residentMemoryString() {
+    const auto kib = residentMemoryKiB();
+    return (kib < 0) ? QStringLiteral("-") : QString::number(kib / 1024.0, 'f', 1) + " MiB";
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Incubates asynchronously created overlay windows in small steps on the GUI thread, so the
+  /// overlays of other screens keep reacting while a new screen gets its window. Owned by the
+  /// engine and not by one of the overlay windows, which can go away with their screen.
+  class OverlayIncubationController : public QObject, public QQmlIncubationController
+  {
+  public:
+    explicit OverlayIncubationController(QObject* parent) : QObject(parent) {}
+
+  protected:
+    void incubatingObjectCountChanged(int count) override
+    {
+      if (count > 0 && m_timerId == 0) { m_timerId = startTimer(0); }
+      else if (count == 0 && m_timerId != 0) { killTimer(m_timerId); m_timerId = 0; }
+    }
+
+    void timerEvent(QTimerEvent*) override { incubateFor(5); }
+
+  private:
+    int m_timerId = 0;
+  };
 } // end anonymous namespace
 
+// -------------------------------------------------------------------------------------------------
+/// Asynchronous creation of an overlay window for a screen.
+class ProjecteurApplication::OverlayIncubator : public QQmlIncubator
+{
+public:
+  using Callback = std::function<void(OverlayIncubator*)>;
+  explicit OverlayIncubator(Callback done)
+    : QQmlIncubator(QQmlIncubator::Asynchronous), m_done(std::move(done)) {}
+
+protected:
+  void statusChanged(Status status) override
+  {
+    if (status == QQmlIncubator::Error)
+    {
+      for (const auto& error : errors()) {
+        logError(mainapp) << error.toString();
+      }
+    }
+    if (status == QQmlIncubator::Ready || status == QQmlIncubator::Error) {
+      m_done(this);
+    }
+  }
+
+private:
+  Callback m_done;
+};
+
 // -------------------------------------------------------------------------------------------------
 ProjecteurApplication::ProjecteurApplication(int &argc, char **argv, const Options& options)
   : QApplication(argc, argv)
@@ -50,6 +134,8 @@ ProjecteurApplication::ProjecteurApplication(int &argc, char **argv, const Optio
   , m_linuxDesktop(new LinuxDesktop(this))
   , m_xcbOnWayland(QGuiApplication::platformName() == "xcb" && m_linuxDesktop->isWayland())
 {
+  m_startupTimer.start();
+
   if (screens().empty())
   {
     const auto title = tr("No Screens detected");
@@ -72,13 +158,17 @@ ProjecteurApplication::ProjecteurApplication(int &argc, char **argv, const Optio
   m_deviceCommandHelper = new DeviceCommandHelper(this, m_spotlight);
 
   m_settings->setOverlayDisabled(options.disableOverlay);
-  m_dialog = std::make_unique<PreferencesDialog>(m_settings, m_spotlight,
-                                                  options.dialogMinimizeOnly
-                                                  ? PreferencesDialog::Mode::MinimizeOnlyDialog
-                                                  : PreferencesDialog::Mode::ClosableDialog);
+  m_dialogMinimizeOnly = options.dialogMinimizeOnly;
 
-  connect(&*m_dialog, &PreferencesDialog::testButtonClicked, this, [this](){
-    m_spotlight->setSpotActive(true);
+  // The preferences dialog is created on demand and released a while after it was closed.
+  m_dialogReleaseTimer = new QTimer(this);
+  m_dialogReleaseTimer->setSingleShot(true);
+  m_dialogReleaseTimer->setInterval(60 * 1000);
+  connect(m_dialogReleaseTimer, &QTimer::timeout, this, [this]()
+  {
+    if (!m_dialog || m_dialog->isVisible()) { return; }
+    m_dialog.reset();
+    logDebug(mainapp) << tr("Preferences dialog released, resident memory: %1").arg(residentMemoryString());
   });
 
   const QString desktopEnv = m_linuxDesktop->type() == LinuxDesktop::Type::KDE ? "KDE" :
@@ -97,58 +187,97 @@ ProjecteurApplication::ProjecteurApplication(int &argc, char **argv, const Optio
     QTimer::singleShot(0, this, [this](){ showPreferences(true); });
   }
   else if (options.dialogMinimizeOnly) {
-    QTimer::singleShot(0, this, [this](){ m_dialog->show(); m_dialog->showMinimized(); });
+    QTimer::singleShot(0, this, [this](){ preferencesDialog()->show(); m_dialog->showMinimized(); });
   }
 
-  // Create qml engine and register context properties
-  m_qmlEngine = new QQmlApplicationEngine(this);
-  m_qmlEngine->rootContext()->setContextProperty("Settings", m_settings);
-  m_qmlEngine->rootContext()->setContextProperty("PreferencesDialog", &*m_dialog);
-  m_qmlEngine->rootContext()->setContextProperty("ProjecteurApp", this);
-
-  // Create qml overlay window component
-  m_windowQmlComponent = new QQmlComponent(m_qmlEngine, QUrl(QStringLiteral("qrc:/main.qml")), m_qmlEngine);
-  if (m_windowQmlComponent->status() != QQmlComponent::Status::Ready) {
-    const auto title = tr("Overlay window error.");
-    const auto text = tr("Qml component has status '%1'. Exiting.").arg(m_windowQmlComponent->status());
-
-    logError(mainapp) << title << ";" << text;
-    for (const auto& error : m_windowQmlComponent->errors()) {
-      logError(mainapp) << error.toString();
+  // Spot position and fade of the overlay windows
+  m_spotController = new SpotController(this);
+  connect(this, &ProjecteurApplication::overlayVisibleChanged, m_spotController, [this](bool visible) {
+    if (visible && m_fadeInHeld) { return; } // see zoom capture on spot activation
+    m_spotController->setVisible(visible);
+  });
+  connect(m_spotlight, &Spotlight::relativeMotion, m_spotController, &SpotController::addRelativeMotion);
+  m_spotController->setPredictionEnabled(m_settings->spotPrediction());
+  connect(m_settings, &Settings::spotPredictionChanged,
+          m_spotController, &SpotController::setPredictionEnabled);
+
+  // Live zoom, keeps the zoomed desktop up to date while the spot is shown
+  m_liveCapture = new LiveDesktopCapture(this);
+  connect(m_liveCapture, &LiveDesktopCapture::updated, this,
+  [this](const LiveDesktopCapture::Patches& patches)
+  {
+    for (const auto& target : m_liveZoomTargets)
+    {
+      if (!target.first) { continue; }
+      for (const auto& patch : patches) {
+        target.first->updateZoomSource(patch.image, patch.position - target.second);
+      }
     }
+  });
+  connect(m_settings, &Settings::zoomLiveRateChanged, m_liveCapture, &LiveDesktopCapture::setRate);
+  connect(m_settings, &Settings::zoomEnabledChanged, this, [this](bool enabled) {
+    if (!enabled) { stopLiveZoom(); }
+  });
 
-    QMessageBox::critical(nullptr, title, text);
-    QTimer::singleShot(0, this, [this](){ this->exit(2); });
-    return;
+  // Compact overlay, the overlay windows only show the area around the spot, see compactOverlay()
+  m_compactOverlayTimer = new QTimer(this);
+  m_compactOverlayTimer->setInterval(8);
+  connect(m_compactOverlayTimer, &QTimer::timeout, this, [this](){ updateCompactOverlayMasks(); });
+  connect(m_settings, &Settings::compactOverlayEnabledChanged, this, [this](){ updateCompactOverlay(); });
+  connect(m_settings, &Settings::showSpotShadeChanged, this, [this](){ updateCompactOverlay(); });
+
+  // The QML engine and the overlay windows are created after the tray icon is shown, and
+  // not at all while the overlay is disabled.
+  if (!m_settings->overlayDisabled()) {
+    QTimer::singleShot(0, this, [this](){ setupOverlay(); });
   }
 
-  // Setup screen overlay windows
-  setupScreenOverlays();
-
   // React to multi-screen and overlay disabled changes in settings.
   connect(m_settings, &Settings::multiScreenOverlayEnabledChanged, this, [this](){ setupScreenOverlays(); });
+  connect(m_settings, &Settings::spanningOverlayEnabledChanged, this, [this](){ setupScreenOverlays(); });
   connect(m_settings, &Settings::overlayDisabledChanged, this, [this](bool disabled){
     if (disabled) {
       if (m_spotlight->spotActive()) { m_spotlight->setSpotActive(false); }
       else { emit m_spotlight->spotActiveChanged(false); }
+      for (const auto window : m_overlayWindows) { window->hide(); }
+    }
+    else if (!m_qmlEngine) {
+      setupOverlay();
     }
     else {
-      QTimer::singleShot(0, this, [this](){
-        if (m_spotlight->spotActive()) {
-          emit m_spotlight->spotActiveChanged(true);
-        } else {
-          m_spotlight->setSpotActive(true);
-        }
-      });
+      reactivateSpot();
     }
   });
 
-  // Re-setup screen overlay(s) when a screen is added or removed
-  connect(this, &ProjecteurApplication::screenAdded, this, [this](){ setupScreenOverlays(); });
-  connect(this, &ProjecteurApplication::screenRemoved, this, [this](){ setupScreenOverlays(); });
+  // Only the overlay window of an added or removed screen is created or released
+  connect(this, &ProjecteurApplication::screenAdded, this, &ProjecteurApplication::addScreenOverlay);
+  connect(this, &ProjecteurApplication::screenRemoved, this, &ProjecteurApplication::removeScreenOverlay);
+
+  // Keep the overlay windows mapped while a device is connected, see mapOverlayWindow()
+  connect(m_spotlight, &Spotlight::anySpotlightDeviceConnectedChanged, this, [this](bool connected){
+    updateOverlayIdleTimer();
+    if (connected && !m_qmlEngine && !m_settings->overlayDisabled())
+    { // Rebuild the overlay in the background after it was unloaded, see unloadOverlay()
+      setupOverlay();
+    }
+    else if (connected && keepOverlayMapped()) {
+      for (const auto window : m_overlayWindows) { mapOverlayWindow(window); }
+    }
+    else if (!connected && !m_spotlight->spotActive()) {
+      for (const auto window : m_overlayWindows) { window->hide(); }
+    }
+  });
+
+  // Optionally unload the overlay after a long idle time, see unloadOverlay()
+  m_overlayIdleTimer = new QTimer(this);
+  m_overlayIdleTimer->setSingleShot(true);
+  connect(m_overlayIdleTimer, &QTimer::timeout, this, [this](){ unloadOverlay(); });
+  connect(m_settings, &Settings::overlayIdleUnloadChanged, this, [this](){ updateOverlayIdleTimer(); });
 
   // Setup the tray icon and menu
   setupTrayIcon();
+  m_startupReadyMs = m_startupTimer.elapsed();
+  logDebug(mainapp) << tr("Startup: tray icon shown after %1 ms.").arg(m_startupReadyMs);
 
   connect(this, &ProjecteurApplication::aboutToQuit, this, [this](){
     for (const auto window : m_overlayWindows) { window->close(); }
@@ -215,49 +344,67 @@ void ProjecteurApplication::setupSpotlight()
   connect(m_spotlight, &Spotlight::spotActiveChanged, this,
   [this](bool active)
   {
+    updateOverlayIdleTimer();
     if (active && !m_settings->overlayDisabled())
     {
+      if (!m_qmlEngine) { setupOverlay(); } // spot is shown as soon as the windows are created
       if (!m_settings->multiScreenOverlayEnabled()) { setScreenForCursorPos(); }
 
-      for (const auto window : m_overlayWindows)
+      if (m_settings->zoomEnabled())
       {
-        window->setFlags(window->flags() | Qt::WindowStaysOnTopHint);
-        window->setFlags(window->flags() & ~Qt::SplashScreen);
-        window->setFlags(window->flags() | Qt::ToolTip);
-        window->setFlags(window->flags() & ~Qt::WindowTransparentForInput);
-
-        if (window->screen())
+        // One capture for all overlay windows, each window shows its own part of it. Results of
+        // captures from previous activations are ignored. Captures on Wayland are finished
+        // asynchronously by the compositor and would contain the overlay, the spot is only
+        // faded in after the capture. On X11 the capture is done right away.
+        for (const auto window : m_overlayWindows) { window->setProperty("desktopImage", QImage()); }
+        m_fadeInHeld = true;
+        m_linuxDesktop->grabDesktopAsync(this,
+        [this, captureGeneration = ++m_zoomCaptureGeneration](const LinuxDesktop::DesktopGrab& grab)
         {
-          if (m_settings->zoomEnabled()) {
-            window->setProperty("desktopPixmap", m_linuxDesktop->grabScreen(window->screen()));
+          if (captureGeneration != m_zoomCaptureGeneration) { return; }
+          for (const auto window : m_overlayWindows) {
+            window->setProperty("desktopImage", grab.areaImage(overlayGeometry(window)));
           }
-
-          const auto screenGeometry = window->screen()->geometry();
-          if (window->geometry() != screenGeometry) {
-            window->setGeometry(screenGeometry);
+          if (m_fadeInHeld) {
+            m_fadeInHeld = false;
+            if (m_overlayVisible) { m_spotController->setVisible(true); }
           }
-          window->setPosition(screenGeometry.topLeft());
+          startLiveZoom(grab);
+        });
+      }
+
+      // Usually the windows are already mapped and only start to accept input, the spot itself
+      // is faded in by the spot controller on the render thread.
+      m_activationFramePending = true;
+      for (const auto window : m_overlayWindows)
+      {
+        if (const auto timing = FrameTiming::of(qobject_cast<QQuickWindow*>(window))) {
+          timing->markActivation();
         }
-        window->showFullScreen();
+        mapOverlayWindow(window);
+        window->setFlags(window->flags() & ~Qt::WindowTransparentForInput);
         window->raise();
       }
       m_overlayVisible = true;
       emit overlayVisibleChanged(true);
+      updateCompactOverlay();
     }
     else
     {
+      stopLiveZoom();
+      m_fadeInHeld = false;
       m_overlayVisible = false;
       emit overlayVisibleChanged(false);
+      updateCompactOverlay();
       for (const auto window : m_overlayWindows)
       {
         window->setFlags(window->flags() | Qt::WindowTransparentForInput);
-        window->setFlags(window->flags() & ~Qt::WindowStaysOnTopHint);
         // Workaround for 'xcb' on Wayland session (default on Ubuntu)
         // .. the window in that case is not transparent for inputs and cannot be clicked through.
         // --> hide the window, although animations will not be visible
         if (m_xcbOnWayland) { window->hide(); }
       }
-      if (m_xcbOnWayland && m_dialog->mode() == PreferencesDialog::Mode::MinimizeOnlyDialog
+      if (m_xcbOnWayland && m_dialog && m_dialog->mode() == PreferencesDialog::Mode::MinimizeOnlyDialog
                          && m_dialog->isMinimized()) { // keep Window minimized...
         //Workaround for QTBUG-76354 (https://bugreports.qt.io/browse/QTBUG-76354)
         m_dialog->showNormal();
@@ -267,13 +414,193 @@ void ProjecteurApplication::setupSpotlight()
   });
 
   connect(m_spotlight, &Spotlight::spotActiveChanged, this, [this](bool active){
-    if (!active && m_dialog->isVisible()) {
+    if (!active && m_dialog && m_dialog->isVisible()) {
       m_dialog->raise();
       m_dialog->activateWindow();
     }
   });
 }
 
+// -------------------------------------------------------------------------------------------------
+bool ProjecteurApplication::spanningOverlay() const
+{
+  // Wayland compositors do not allow clients to place a window across screens.
+  return m_settings->multiScreenOverlayEnabled() && m_settings->spanningOverlayEnabled()
+         && !m_linuxDesktop->isWayland();
+}
+
+// -------------------------------------------------------------------------------------------------
+QRect ProjecteurApplication::overlayGeometry(const QWindow* window) const
+{
+  const auto screen = window->screen();
+  if (!screen) { return QRect(); }
+  return window->property("spansScreens").toBool() ? screen->virtualGeometry() : screen->geometry();
+}
+
+// -------------------------------------------------------------------------------------------------
+bool ProjecteurApplication::compactOverlay() const
+{
+  // Window masks are X11 shape regions, with Wayland only the input region could be set.
+  return m_settings->compactOverlayEnabled() && !m_settings->showSpotShade()
+         && !m_linuxDesktop->isWayland() && !m_xcbOnWayland;
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::updateCompactOverlay()
+{
+  const bool compact = compactOverlay();
+  if (compact && m_overlayVisible)
+  {
+    m_compactOverlayCursorPos = QPoint(-1, -1);
+    updateCompactOverlayMasks();
+    m_compactOverlayTimer->start();
+    return;
+  }
+
+  // The masks stay while the spot fades out and until the compact overlay is disabled.
+  m_compactOverlayTimer->stop();
+  if (!compact)
+  {
+    for (const auto window : m_overlayWindows)
+    {
+      if (!window->mask().isEmpty()) { window->setMask(QRegion()); }
+      // Windows without the spot were transparent for input, see updateCompactOverlayMasks()
+      if (m_overlayVisible && window->flags().testFlag(Qt::WindowTransparentForInput)) {
+        window->setFlags(window->flags() & ~Qt::WindowTransparentForInput);
+      }
+    }
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::updateCompactOverlayMasks()
+{
+  // Mouse events of the overlay windows are limited to their mask, the cursor is polled instead.
+  const QPoint cursorPos = QCursor::pos();
+  if (cursorPos != m_compactOverlayCursorPos)
+  {
+    m_compactOverlayCursorPos = cursorPos;
+    m_spotController->addSample(cursorPos);
+    if (const auto screen = screenAtCursorPos())
+    {
+      if (m_settings->multiScreenOverlayEnabled()) { setCurrentSpotScreen(quint64(screen)); }
+      else if (!m_overlayWindows.empty() && m_overlayWindows.first()->screen() != screen) {
+        setScreenForCursorPos();
+      }
+    }
+  }
+
+  for (const auto window : m_overlayWindows)
+  {
+    // Only a pixel of windows without the spot is shown, an empty region would remove the mask.
+    // These windows are transparent for input, the pixel would take the clicks in the corner
+    // of the screen otherwise (e.g. hot corners).
+    QRegion mask(0, 0, 1, 1);
+    const auto item = window->findChild<SpotlightItem*>();
+    const QRect geometry = window->geometry();
+    const bool hasSpot = item && geometry.contains(cursorPos);
+    const auto flags = hasSpot ? window->flags() & ~Qt::WindowTransparentForInput
+                               : window->flags() | Qt::WindowTransparentForInput;
+    if (flags != window->flags()) { window->setFlags(flags); }
+    if (hasSpot)
+    {
+      // Bounds of the spot with border, rotated shapes and a margin for the spot prediction.
+      const qreal spotSize = item->spotSize();
+      const qreal half = (spotSize / 2 + spotSize * item->borderSize() / 100.0)
+                         * (m_settings->spotRotationAllowed() ? M_SQRT2 : 1.0) + 16;
+      const QPoint center = cursorPos - geometry.topLeft();
+      mask = QRegion(QRectF(center.x() - half, center.y() - half, 2 * half, 2 * half).toAlignedRect());
+    }
+    if (window->mask() != mask) { window->setMask(mask); }
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+bool ProjecteurApplication::keepOverlayMapped() const
+{
+  // With 'xcb' on Wayland mapped windows are not transparent for input, see setupSpotlight()
+  return !m_xcbOnWayland && !m_settings->overlayDisabled() && m_spotlight->anySpotlightDeviceConnected();
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::mapOverlayWindow(QWindow* window)
+{
+  // Mapping and configuring the window can take a while with some window managers and
+  // compositors, which delays the first spot. It is done only once and the window then stays
+  // mapped, invisible and transparent for input while the spot is not active.
+  const auto geometry = overlayGeometry(window);
+  if (geometry.isEmpty()) { return; }
+  if (window->isVisible() && window->geometry() == geometry) { return; }
+
+  window->setGeometry(geometry);
+  if (window->property("spansScreens").toBool()) {
+    window->show(); // full screen would be limited to one screen
+  } else {
+    window->showFullScreen();
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::logFrameTiming(bool reset)
+{
+  logInfo(mainapp) << tr("Startup: tray icon after %1 ms, first overlay window after %2 ms.")
+                      .arg(m_startupReadyMs).arg(m_startupOverlayMs);
+  logInfo(mainapp) << tr("Resident memory: %1; overlay %2, preferences dialog %3.")
+                      .arg(residentMemoryString(), m_qmlEngine ? tr("loaded") : tr("not loaded"),
+                           m_dialog ? tr("loaded") : tr("not loaded"));
+  logInfo(mainapp) << tr("Settings file written %1 time(s) during the last minute.")
+                      .arg(m_settings->flushesPerMinute());
+  for (const auto window : m_overlayWindows)
+  {
+    const auto timing = FrameTiming::of(qobject_cast<QQuickWindow*>(window));
+    if (!timing) { continue; }
+
+    const auto screen = window->screen();
+    logInfo(mainapp) << tr("Frame timing of overlay window on screen '%1':")
+                        .arg(screen ? screen->name() : QString());
+    for (const auto& line : timing->report().split('\n')) {
+      logInfo(mainapp) << "  " + line;
+    }
+    if (reset) { timing->reset(); }
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::startLiveZoom(const LinuxDesktop::DesktopGrab& grab)
+{
+  stopLiveZoom();
+  if (m_settings->zoomLiveRate() <= 0 || grab.image.isNull()) { return; }
+
+  if (m_linuxDesktop->isWayland()) {
+    logWarning(mainapp) << tr("Live zoom is currently only supported on X11.");
+    return;
+  }
+
+  // Patches are in pixels of the complete desktop grab, each spotlight item shows one screen
+  // (or all of them, see spanningOverlay()).
+  std::vector<WId> overlayWindows;
+  for (const auto window : m_overlayWindows)
+  {
+    overlayWindows.push_back(window->winId());
+    const auto item = window->findChild<SpotlightItem*>();
+    const QRect pixels = grab.areaRect(overlayGeometry(window));
+    if (item && !pixels.isEmpty()) {
+      m_liveZoomTargets.emplace_back(item, pixels.topLeft());
+    }
+  }
+
+  if (!m_liveCapture->start(grab, m_settings->zoomLiveRate(), overlayWindows)) {
+    m_liveZoomTargets.clear();
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::stopLiveZoom()
+{
+  m_liveCapture->stop();
+  m_liveZoomTargets.clear();
+}
+
 // -------------------------------------------------------------------------------------------------
 void ProjecteurApplication::setupTrayIcon()
 {
@@ -304,9 +631,9 @@ void ProjecteurApplication::setupTrayIcon()
   });
 
   m_trayMenu->addSeparator();
-  const auto actionQuit = m_trayMenu->addAction(tr("&Quit"));
-  connect(actionQuit, &QAction::triggered, this, [this](){
-    m_qmlEngine->deleteLater(); // see: https://bugreports.qt.io/browse/QTBUG-81247
+  m_actionQuit = m_trayMenu->addAction(tr("&Quit"));
+  connect(m_actionQuit, &QAction::triggered, this, [this](){
+    if (m_qmlEngine) { m_qmlEngine->deleteLater(); } // see: https://bugreports.qt.io/browse/QTBUG-81247
     this->quit();
   });
   m_trayIcon->setContextMenu(&*m_trayMenu);
@@ -336,20 +663,187 @@ void ProjecteurApplication::setupTrayIcon()
       }
     }
   });
+}
+
+// -------------------------------------------------------------------------------------------------
+PreferencesDialog* ProjecteurApplication::preferencesDialog()
+{
+  if (!m_dialog)
+  {
+    QElapsedTimer timer;
+    timer.start();
+    m_dialog = std::make_unique<PreferencesDialog>(m_settings, m_spotlight,
+                                                    m_dialogMinimizeOnly
+                                                    ? PreferencesDialog::Mode::MinimizeOnlyDialog
+                                                    : PreferencesDialog::Mode::ClosableDialog);
+    m_dialog->installEventFilter(this);
+
+    connect(&*m_dialog, &PreferencesDialog::testButtonClicked, this, [this](){
+      m_spotlight->setSpotActive(true);
+    });
 
-  connect(&*m_dialog, &PreferencesDialog::exitApplicationRequested, actionQuit, [actionQuit]() {
-    logDebug(mainapp) << tr("Exit request from preferences dialog.");
-    actionQuit->trigger();
+    connect(&*m_dialog, &PreferencesDialog::exitApplicationRequested, m_actionQuit, [this]() {
+      logDebug(mainapp) << tr("Exit request from preferences dialog.");
+      m_actionQuit->trigger();
+    });
+    logDebug(mainapp) << tr("Preferences dialog created in %1 ms.").arg(timer.elapsed());
+  }
+  return &*m_dialog;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool ProjecteurApplication::eventFilter(QObject* watched, QEvent* event)
+{
+  if (m_dialog && watched == &*m_dialog)
+  {
+    if (event->type() == QEvent::Hide && !m_dialog->isVisible()) { m_dialogReleaseTimer->start(); }
+    else if (event->type() == QEvent::Show) { m_dialogReleaseTimer->stop(); }
+  }
+  return QApplication::eventFilter(watched, event);
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::setupOverlay()
+{
+  if (m_qmlEngine) { return; }
+
+  // Create qml engine and register context properties
+  m_qmlEngine = new QQmlApplicationEngine(this);
+  m_qmlEngine->setIncubationController(new OverlayIncubationController(m_qmlEngine));
+  m_qmlEngine->rootContext()->setContextProperty("Settings", m_settings);
+  m_qmlEngine->rootContext()->setContextProperty("ProjecteurApp", this);
+  m_qmlEngine->rootContext()->setContextProperty("SpotController", m_spotController);
+
+  // Load the overlay window component, the windows are created when it is ready.
+  QElapsedTimer loadTimer;
+  loadTimer.start();
+  m_windowQmlComponent = new QQmlComponent(m_qmlEngine, m_qmlEngine);
+  connect(m_windowQmlComponent, &QQmlComponent::statusChanged, this,
+  [this, loadTimer](QQmlComponent::Status status)
+  {
+    if (status == QQmlComponent::Status::Ready)
+    {
+      logDebug(mainapp) << tr("Overlay window component loaded in %1 ms.").arg(loadTimer.elapsed());
+      setupScreenOverlays();
+    }
+    else if (status == QQmlComponent::Status::Error)
+    {
+      const auto title = tr("Overlay window error.");
+      const auto text = tr("Qml component has status '%1'. Exiting.").arg(status);
+
+      logError(mainapp) << title << ";" << text;
+      for (const auto& error : m_windowQmlComponent->errors()) {
+        logError(mainapp) << error.toString();
+      }
+
+      QMessageBox::critical(nullptr, title, text);
+      QTimer::singleShot(0, this, [this](){ this->exit(2); });
+    }
+  });
+  m_windowQmlComponent->loadUrl(QUrl(QStringLiteral("qrc:/main.qml")), QQmlComponent::Asynchronous);
+  updateOverlayIdleTimer();
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::updateOverlayIdleTimer()
+{
+  const int minutes = m_settings->overlayIdleUnload();
+  if (minutes > 0 && m_qmlEngine && !m_spotlight->spotActive()
+      && !m_spotlight->anySpotlightDeviceConnected()) {
+    m_overlayIdleTimer->start(minutes * 60 * 1000);
+  } else {
+    m_overlayIdleTimer->stop();
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::unloadOverlay()
+{
+  if (!m_qmlEngine || m_spotlight->spotActive()) { return; }
+
+  // Released with the engine, it is created again when a device connects or the spot is activated.
+  stopLiveZoom();
+  m_compactOverlayTimer->stop();
+  m_pendingOverlays.clear();
+  for (const auto window : m_overlayWindows) { window->hide(); }
+  m_overlayWindows.clear();
+  m_screenWindowMap.clear();
+  m_windowQmlComponent = nullptr;
+  m_qmlEngine->deleteLater(); // the overlay windows and the component are children of the engine
+  m_qmlEngine = nullptr;
+
+  logInfo(mainapp) << tr("Overlay unloaded after %1 idle minutes.").arg(m_settings->overlayIdleUnload());
+  QTimer::singleShot(1000, this, [](){
+    logDebug(mainapp) << tr("Resident memory after unloading the overlay: %1").arg(residentMemoryString());
   });
 }
 
 // -------------------------------------------------------------------------------------------------
-QWindow* ProjecteurApplication::createOverlayWindow()
+void ProjecteurApplication::createOverlayWindowAsync(QScreen* screen)
+{
+  if (!m_windowQmlComponent || !m_windowQmlComponent->isReady()) { return; }
+  if (m_pendingOverlays.count(screen)) { return; }
+
+  auto incubator = std::make_unique<OverlayIncubator>([this, screen](OverlayIncubator* incubator)
+  {
+    // The incubator must not be deleted while it reports its status.
+    QTimer::singleShot(0, this, [this, screen, incubator]() {
+      const auto it = m_pendingOverlays.find(screen);
+      if (it != m_pendingOverlays.end() && it->second.get() == incubator) { m_pendingOverlays.erase(it); }
+    });
+    if (!incubator->isReady()) { return; }
+
+    const auto window = setupOverlayWindow(incubator->object());
+    const bool perScreen = m_settings->multiScreenOverlayEnabled() && !spanningOverlay();
+    if (perScreen ? (!screens().contains(screen) || m_screenWindowMap.count(screen))
+                  : !m_overlayWindows.empty())
+    {
+      window->deleteLater();
+      return;
+    }
+
+    m_overlayWindows.push_back(window);
+    if (perScreen)
+    {
+      m_screenWindowMap[screen] = window;
+      updateOverlayWindow(window, screen);
+    }
+    else if (spanningOverlay()) {
+      updateSpanningWindow();
+    }
+    else
+    { // Single overlay window, the key screen is not used, it might be gone already.
+      const auto cursorScreen = screenAtCursorPos();
+      updateOverlayWindow(window, cursorScreen ? cursorScreen : primaryScreen());
+    }
+    if (keepOverlayMapped()) { mapOverlayWindow(window); }
+    if (m_spotlight->spotActive()) { reactivateSpot(); }
+
+    if (m_startupOverlayMs < 0)
+    {
+      m_startupOverlayMs = m_startupTimer.elapsed();
+      logDebug(mainapp) << tr("Startup: first overlay window ready after %1 ms.").arg(m_startupOverlayMs);
+    }
+  });
+  m_windowQmlComponent->create(*incubator);
+  m_pendingOverlays.emplace(screen, std::move(incubator));
+}
+
+// -------------------------------------------------------------------------------------------------
+QWindow* ProjecteurApplication::setupOverlayWindow(QObject* object)
 {
-  QObject *object = m_windowQmlComponent->create();
   object->setParent(m_qmlEngine);
   const auto window = qobject_cast<QWindow*>(object);
-  window->setFlags(window->flags() | Qt::WindowTransparentForInput | Qt::Tool);
+  window->setFlags(overlayWindowFlags() | Qt::WindowTransparentForInput);
+  if (const auto quickWindow = qobject_cast<QQuickWindow*>(window))
+  {
+    const auto timing = new FrameTiming(quickWindow);
+    connect(timing, &FrameTiming::activationFrameSwapped, this, [this](qint64 latencyUs) {
+      if (!m_activationFramePending) { return; }
+      m_activationFramePending = false;
+      logDebug(mainapp) << tr("Spot activation to first frame: %1 ms").arg(latencyUs / 1000.0, 0, 'f', 1);
+    });
+  }
   return window;
 }
 
@@ -371,12 +865,6 @@ void ProjecteurApplication::cursorEntered(quint64 screen)
   setCurrentSpotScreen(screen);
 }
 
-// -------------------------------------------------------------------------------------------------
-void ProjecteurApplication::cursorPositionChanged(const QPoint& pos)
-{
-  setCurrentCursorPos(pos);
-}
-
 // -------------------------------------------------------------------------------------------------
 void ProjecteurApplication::updateOverlayWindow(QWindow* window, QScreen* screen)
 {
@@ -384,12 +872,18 @@ void ProjecteurApplication::updateOverlayWindow(QWindow* window, QScreen* screen
     return;
   }
 
-  if (window->screen() == screen && screen->geometry() == window->geometry()) {
+  window->setProperty("screenId", quint64(screen));
+  window->setProperty("spansScreens", false);
+  window->setProperty("screenHeight", screen->geometry().height());
+
+  if (window->screen() == screen)
+  {
+    // Only the geometry or resolution of the screen changed, the window stays mapped.
+    if (window->geometry() != screen->geometry()) { window->setGeometry(screen->geometry()); }
+    if (const auto quickWindow = qobject_cast<QQuickWindow*>(window)) { quickWindow->update(); }
     return;
   }
 
-  window->setProperty("screenId", quint64(screen));
-
   const bool wasVisible = window->isVisible();
   const bool wasSpotActive = m_spotlight->spotActive();
 
@@ -397,14 +891,14 @@ void ProjecteurApplication::updateOverlayWindow(QWindow* window, QScreen* screen
   emit overlayVisibleChanged(false);
 
   window->setFlags(window->flags() | Qt::WindowTransparentForInput);
-  window->setFlags(window->flags() & ~Qt::WindowStaysOnTopHint);
   window->hide();
 
   window->setGeometry(QRect(screen->geometry().topLeft(), QSize(300,200)));
   window->setScreen(screen);
   window->setGeometry(screen->geometry());
+  if (keepOverlayMapped()) { mapOverlayWindow(window); }
 
-  if (m_xcbOnWayland && !wasVisible)
+  if (m_xcbOnWayland && !wasVisible && m_dialog)
   {
     if (m_dialog->mode() == PreferencesDialog::Mode::MinimizeOnlyDialog
         && m_dialog->isMinimized()) { // keep Window minimized...
@@ -415,19 +909,36 @@ void ProjecteurApplication::updateOverlayWindow(QWindow* window, QScreen* screen
   }
 
   if (wasVisible && wasSpotActive) {
-    QTimer::singleShot(0, this, [this](){
-      if (m_spotlight->spotActive()) {
-        emit m_spotlight->spotActiveChanged(true);
-      } else {
-        m_spotlight->setSpotActive(true);
-      }
-    });
+    reactivateSpot();
   }
 }
 
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::updateSpanningWindow()
+{
+  const auto primaryScreen = QGuiApplication::primaryScreen();
+  if (m_overlayWindows.empty() || !primaryScreen) { return; }
+
+  // The spot is always on this window, its size is relative to the primary screen.
+  const auto window = m_overlayWindows.first();
+  window->setProperty("spansScreens", true);
+  window->setProperty("screenHeight", primaryScreen->geometry().height());
+  if (window->screen() != primaryScreen)
+  {
+    window->hide();
+    window->setScreen(primaryScreen);
+  }
+
+  const auto geometry = overlayGeometry(window);
+  if (window->geometry() != geometry) { window->setGeometry(geometry); }
+  if (keepOverlayMapped()) { mapOverlayWindow(window); }
+  if (const auto quickWindow = qobject_cast<QQuickWindow*>(window)) { quickWindow->update(); }
+}
+
 // -------------------------------------------------------------------------------------------------
 void ProjecteurApplication::setScreenForCursorPos()
 {
+  if (m_overlayWindows.empty()) { return; }
   updateOverlayWindow(m_overlayWindows.first(), screenAtCursorPos());
 }
 
@@ -447,78 +958,139 @@ QScreen* ProjecteurApplication::screenAtCursorPos() const
 }
 
 // -------------------------------------------------------------------------------------------------
-void ProjecteurApplication::setupScreenOverlays()
+void ProjecteurApplication::reactivateSpot()
 {
-  m_screenWindowMap.clear();
+  QTimer::singleShot(0, this, [this](){
+    if (m_spotlight->spotActive()) {
+      emit m_spotlight->spotActiveChanged(true);
+    } else {
+      m_spotlight->setSpotActive(true);
+    }
+  });
+}
 
-  const auto currentScreens = screens();
-  if (currentScreens.empty())
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::connectScreen(QScreen* screen)
+{
+  // Geometry and resolution changes update the overlay window in place
+  disconnect(screen, nullptr, this, nullptr);
+  const auto update = [this, screen]()
   {
-    for (const auto window : m_overlayWindows) { window->deleteLater(); }
-    m_overlayWindows.clear();
-    return;
+    if (spanningOverlay()) {
+      updateSpanningWindow();
+    }
+    else if (m_settings->multiScreenOverlayEnabled())
+    {
+      const auto it = m_screenWindowMap.find(screen);
+      if (it != m_screenWindowMap.cend()) { updateOverlayWindow(it->second, screen); }
+    }
+    else if (!m_overlayWindows.empty() && m_overlayWindows.first()->screen() == screen) {
+      updateOverlayWindow(m_overlayWindows.first(), screen);
+    }
+  };
+  connect(screen, &QScreen::geometryChanged, this, update);
+  connect(screen, &QScreen::logicalDotsPerInchChanged, this, update);
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::addScreenOverlay(QScreen* screen)
+{
+  connectScreen(screen);
+  if (spanningOverlay()) { updateSpanningWindow(); }
+  else if (m_settings->multiScreenOverlayEnabled()) { createOverlayWindowAsync(screen); }
+}
+
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::removeScreenOverlay(QScreen* screen)
+{
+  disconnect(screen, nullptr, this, nullptr);
+  if (m_settings->multiScreenOverlayEnabled() && !spanningOverlay()) {
+    m_pendingOverlays.erase(screen); // cancels the incubation
   }
 
-  // disconnect any connected screen signals previously connected to `this`
-  // and connect to geometryChanged signal to update overlay windows on screen geometry changes
-  for (const auto screen : currentScreens) {
-    disconnect(screen, nullptr, this, nullptr);
-    connect(screen, &QScreen::geometryChanged, this, [this, screen]()
-    {
-      if (m_settings->multiScreenOverlayEnabled())
-      {
-        const auto it = m_screenWindowMap.find(screen);
-        if (it == m_screenWindowMap.cend()) { return; }
-        updateOverlayWindow(it->second, it->first);
-      }
-      else {
-        setScreenForCursorPos();
-      }
-    });
+  const auto it = m_screenWindowMap.find(screen);
+  if (it != m_screenWindowMap.end())
+  {
+    const auto window = it->second;
+    m_screenWindowMap.erase(it);
+    m_overlayWindows.removeAll(window);
+    window->hide();
+    window->deleteLater();
   }
+  else if (spanningOverlay()) {
+    QTimer::singleShot(0, this, [this](){ updateSpanningWindow(); });
+  }
+  else if (!m_settings->multiScreenOverlayEnabled() && m_spotlight->spotActive())
+  {
+    // Qt moves the single window to another screen, put it on the screen with the cursor.
+    QTimer::singleShot(0, this, [this](){ setScreenForCursorPos(); });
+  }
+}
 
-  // Adapt number of overlay windows depending on multiScreenOverlayEnabled() and
-  // the number of screens
-  const int numOverlayWindows = m_settings->multiScreenOverlayEnabled() ? currentScreens.size() : 1;
-  const bool wasSpotActive = m_spotlight->spotActive();
+// -------------------------------------------------------------------------------------------------
+void ProjecteurApplication::setupScreenOverlays()
+{
+  if (!m_windowQmlComponent || !m_windowQmlComponent->isReady()) { return; }
 
-  while (m_overlayWindows.size() > numOverlayWindows) {
-    m_overlayWindows.back()->deleteLater();
-    m_overlayWindows.pop_back();
- }
+  const auto currentScreens = screens();
+  for (const auto screen : currentScreens) { connectScreen(screen); }
 
-  while (m_overlayWindows.size() < numOverlayWindows) {
-    m_overlayWindows.push_back(createOverlayWindow());
+  if (spanningOverlay())
+  {
+    // One window covering all screens with a single render loop and scene graph.
+    m_screenWindowMap.clear();
+    m_pendingOverlays.clear();
+    while (m_overlayWindows.size() > 1) {
+      m_overlayWindows.back()->deleteLater();
+      m_overlayWindows.pop_back();
+    }
+    if (m_overlayWindows.empty()) { createOverlayWindowAsync(primaryScreen()); }
+    updateSpanningWindow();
   }
-
-  // Default behavior - only one overlay window that is moved across sreens
-  if (!m_settings->multiScreenOverlayEnabled())
+  else if (m_settings->multiScreenOverlayEnabled())
   {
+    // Keep the windows that are already on one of the screens, create the missing ones.
+    m_screenWindowMap.clear();
+    QList<QWindow*> windows;
+    for (const auto window : m_overlayWindows)
+    {
+      const auto screen = window->screen();
+      if (screen && currentScreens.contains(screen) && !m_screenWindowMap.count(screen))
+      {
+        m_screenWindowMap[screen] = window;
+        windows.push_back(window);
+        updateOverlayWindow(window, screen);
+      }
+      else { window->deleteLater(); }
+    }
+    m_overlayWindows = windows;
+
     for (const auto screen : currentScreens) {
-      m_screenWindowMap[screen] = m_overlayWindows.front();
+      if (!m_screenWindowMap.count(screen)) { createOverlayWindowAsync(screen); }
     }
   }
   else
-  { // multi-screen overlays enabled: assign overlay windows to screens
-    auto wit = m_overlayWindows.cbegin();
-    for (const auto screen : currentScreens) {
-      m_screenWindowMap[screen] = (*wit);
-      updateOverlayWindow(*wit, screen);
-      ++wit;
+  {
+    // Only one overlay window that is moved across screens.
+    m_screenWindowMap.clear();
+    m_pendingOverlays.clear();
+    while (m_overlayWindows.size() > 1) {
+      m_overlayWindows.back()->deleteLater();
+      m_overlayWindows.pop_back();
+    }
+    if (m_overlayWindows.empty()) { createOverlayWindowAsync(primaryScreen()); }
+    else if (m_overlayWindows.first()->property("spansScreens").toBool()) {
+      updateOverlayWindow(m_overlayWindows.first(), m_overlayWindows.first()->screen());
     }
   }
 
-  // If the spotlight was active was active when calling the setup function,
-  // make sure it will be activated again.
-  if (wasSpotActive) {
-    QTimer::singleShot(0, this, [this](){
-      if (m_spotlight->spotActive()) {
-        emit m_spotlight->spotActiveChanged(true);
-      } else {
-        m_spotlight->setSpotActive(true);
-      }
-    });
+  if (keepOverlayMapped()) {
+    for (const auto window : m_overlayWindows) { mapOverlayWindow(window); }
   }
+
+  // If the spotlight was active when calling the setup function,
+  // make sure it will be activated again.
+  if (m_spotlight->spotActive()) { reactivateSpot(); }
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -535,20 +1107,6 @@ void ProjecteurApplication::setCurrentSpotScreen(quint64 screen)
   emit currentSpotScreenChanged(m_currentSpotScreen);
 }
 
-// -------------------------------------------------------------------------------------------------
-QPoint ProjecteurApplication::currentCursorPos() const
-{
-  return m_currentCursorPos;
-}
-
-// -------------------------------------------------------------------------------------------------
-void ProjecteurApplication::setCurrentCursorPos(const QPoint& pos)
-{
-  if (pos == m_currentCursorPos) { return; }
-  m_currentCursorPos = pos;
-  emit currentCursorPosChanged(m_currentCursorPos);
-}
-
 // -------------------------------------------------------------------------------------------------
 void ProjecteurApplication::readCommand(QLocalSocket* clientConnection)
 {
@@ -659,6 +1217,11 @@ void ProjecteurApplication::readCommand(QLocalSocket* clientConnection)
     logDebug(cmdserver) << tr("Received command settings = %1").arg(show);
     showPreferences(show);
   }
+  else if (cmdKey == "stats")
+  {
+    logDebug(cmdserver) << tr("Received command stats = %1").arg(cmdValue);
+    logFrameTiming(cmdValue.toLower() == "reset");
+  }
   else if (cmdKey == "preset")
   {
     logDebug(cmdserver) << tr("Received command preset = %1").arg(cmdValue);
@@ -689,12 +1252,13 @@ void ProjecteurApplication::showPreferences(bool show)
 {
   if (show)
   {
-    m_dialog->show();
-    m_dialog->raise();
+    const auto dialog = preferencesDialog();
+    dialog->show();
+    dialog->raise();
     static const bool qtPlatformIsWayland = QGuiApplication::platformName().toLower().startsWith("wayland");
-    if (!qtPlatformIsWayland) { m_dialog->activateWindow(); }
+    if (!qtPlatformIsWayland) { dialog->activateWindow(); }
   }
-  else {
+  else if (m_dialog) {
     if (m_dialog->mode() == PreferencesDialog::Mode::MinimizeOnlyDialog) {
       m_dialog->showMinimized();
     } else {
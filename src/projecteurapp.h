@@ -3,16 +3,21 @@
 #pragma once
 
 #include "devicescan.h"
+#include "linuxdesktop.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QPoint>
 #include <QPointer>
 
 #include <map>
 #include <memory>
+#include <vector>
 
 class AboutDialog;
+class QAction;
 class DeviceCommandHelper;
-class LinuxDesktop;
+class LiveDesktopCapture;
 class PreferencesDialog;
 class QLocalServer;
 class QLocalSocket;
@@ -20,15 +25,17 @@ class QMenu;
 class QQmlApplicationEngine;
 class QQmlComponent;
 class QSystemTrayIcon;
+class QTimer;
 class Settings;
+class SpotController;
 class Spotlight;
+class SpotlightItem;
 
 class ProjecteurApplication : public QApplication
 {
   Q_OBJECT
   Q_PROPERTY(bool overlayVisible READ overlayVisible NOTIFY overlayVisibleChanged)
   Q_PROPERTY(quint64 currentSpotScreen READ currentSpotScreen NOTIFY currentSpotScreenChanged)
-  Q_PROPERTY(QPoint currentCursorPos READ currentCursorPos NOTIFY currentCursorPosChanged)
 
 public:
   struct Options {
@@ -48,13 +55,14 @@ public:
 signals:
   void overlayVisibleChanged(bool visible);
   void currentSpotScreenChanged(quint64 screen);
-  void currentCursorPosChanged(const QPoint& pos);
 
 public slots:
   void cursorExitedWindow();
   void cursorEntered(quint64 screen);
   void spotlightWindowClicked();
-  void cursorPositionChanged(const QPoint& pos);
+
+protected:
+  bool eventFilter(QObject* watched, QEvent* event) override;
 
 private slots:
   void readCommand(QLocalSocket* client);
@@ -63,25 +71,47 @@ private:
   void showPreferences(bool show = true);
   void setScreenForCursorPos();
   QScreen* screenAtCursorPos() const;
-  QWindow* createOverlayWindow();
+  void setupOverlay();
+  void unloadOverlay();
+  void updateOverlayIdleTimer();
+  PreferencesDialog* preferencesDialog();
+  void createOverlayWindowAsync(QScreen* screen);
+  QWindow* setupOverlayWindow(QObject* object);
   void updateOverlayWindow(QWindow* window, QScreen* screen);
+  void updateSpanningWindow();
+  bool spanningOverlay() const;
+  QRect overlayGeometry(const QWindow* window) const;
+  bool compactOverlay() const;
+  void updateCompactOverlay();
+  void updateCompactOverlayMasks();
+  bool keepOverlayMapped() const;
+  void mapOverlayWindow(QWindow* window);
+  void logFrameTiming(bool reset);
   void setupScreenOverlays();
+  void connectScreen(QScreen* screen);
+  void addScreenOverlay(QScreen* screen);
+  void removeScreenOverlay(QScreen* screen);
+  void reactivateSpot();
   quint64 currentSpotScreen() const;
   void setCurrentSpotScreen(quint64 screen);
-  QPoint currentCursorPos() const;
-  void setCurrentCursorPos(const QPoint& pos);
 
   void setupTrayIcon();
   void setupSpotlight();
+  void startLiveZoom(const LinuxDesktop::DesktopGrab& grab);
+  void stopLiveZoom();
 
 private:
   std::unique_ptr<QSystemTrayIcon> m_trayIcon;
   std::unique_ptr<QMenu> m_trayMenu;
-  std::unique_ptr<PreferencesDialog> m_dialog;
+  std::unique_ptr<PreferencesDialog> m_dialog; // created on demand, see preferencesDialog()
+  bool m_dialogMinimizeOnly = false;
+  QTimer* m_dialogReleaseTimer = nullptr;
+  QAction* m_actionQuit = nullptr;
   QPointer<AboutDialog> m_aboutDialog;
   QLocalServer* const m_localServer = nullptr;
   Settings* m_settings = nullptr;
   Spotlight* m_spotlight = nullptr;
+  SpotController* m_spotController = nullptr;
   DeviceCommandHelper* m_deviceCommandHelper = nullptr;
   LinuxDesktop* m_linuxDesktop = nullptr;
   QQmlApplicationEngine* m_qmlEngine = nullptr;
@@ -91,9 +121,21 @@ private:
   const bool m_xcbOnWayland = false;
 
   QList<QWindow*> m_overlayWindows;
-  std::map<QScreen*, QWindow*> m_screenWindowMap;
+  std::map<QScreen*, QWindow*> m_screenWindowMap; // only with multi-screen overlays
+  class OverlayIncubator;
+  std::map<QScreen*, std::unique_ptr<OverlayIncubator>> m_pendingOverlays;
   quint64 m_currentSpotScreen = 0;
-  QPoint m_currentCursorPos;
+  quint64 m_zoomCaptureGeneration = 0;
+  bool m_fadeInHeld = false; ///< Spot is faded in after the zoom capture, to not capture the overlay.
+  LiveDesktopCapture* m_liveCapture = nullptr;
+  std::vector<std::pair<QPointer<SpotlightItem>, QPoint>> m_liveZoomTargets; // item, screen offset
+  bool m_activationFramePending = false; // log the latency of the first frame after activation
+  QTimer* m_compactOverlayTimer = nullptr;
+  QTimer* m_overlayIdleTimer = nullptr;
+  QPoint m_compactOverlayCursorPos;
+  QElapsedTimer m_startupTimer;
+  qint64 m_startupReadyMs = -1;   // tray icon shown
+  qint64 m_startupOverlayMs = -1; // first overlay window created
 };
 
 class ProjecteurCommandClientApp : public QCoreApplication
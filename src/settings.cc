@@ -3,19 +3,34 @@
 
 #include "settings.h"
 
+#include "asynchronous.h"
 #include "device.h"
 #include "deviceinput.h"
+#include "inotify-helper.h"
+#include "inputmapstore.h"
 #include "logging.h"
 
 #include <algorithm>
+#include <set>
+#include <thread>
 #include <utility>
 
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QFile>
 #include <QFileInfo>
 #include <QFont>
 #include <QGuiApplication>
 #include <QPalette>
+#include <QPointer>
 #include <QQmlPropertyMap>
 #include <QSettings>
+#include <QTimer>
+#include <QUrl>
+
+#include <sys/inotify.h>
 
 LOGGING_CATEGORY(lcSettings, "settings")
 
@@ -40,6 +55,12 @@ namespace {
     constexpr char zoomEnabled[] = "enableZoom";
     constexpr char zoomFactor[] = "zoomFactor";
     constexpr char multiScreenOverlay[] = "multiScreenOverlay";
+    constexpr char holdMoveInterval[] = "holdMoveInterval";
+    constexpr char spotPrediction[] = "spotPrediction";
+    constexpr char spanningOverlay[] = "spanningOverlay";
+    constexpr char compactOverlay[] = "compactOverlay";
+    constexpr char overlayIdleUnload[] = "overlayIdleUnload";
+    constexpr char zoomLiveRate[] = "zoomLiveRate";
 
     // -- device specific
     constexpr char inputSequenceInterval[] = "inputSequenceInterval";
@@ -68,6 +89,12 @@ namespace {
       constexpr bool zoomEnabled = false;
       constexpr double zoomFactor = 2.0;
       constexpr bool multiScreenOverlay = false;
+      constexpr int holdMoveInterval = 30;
+      constexpr bool spotPrediction = false;
+      constexpr bool spanningOverlay = false;
+      constexpr bool compactOverlay = false;
+      constexpr int overlayIdleUnload = 0;
+      constexpr int zoomLiveRate = 0;
 
       // -- device specific defaults
       constexpr int inputSequenceInterval = 250;
@@ -84,11 +111,21 @@ namespace {
       constexpr Settings::SettingRange<int> borderSize{ 0, 100 };
       constexpr Settings::SettingRange<double> borderOpacity{ 0.0, 1.0 };
       constexpr Settings::SettingRange<double> zoomFactor{ 1.5, 20.0 };
+      constexpr Settings::SettingRange<int> zoomLiveRate{ 0, 60 };
+      constexpr Settings::SettingRange<int> overlayIdleUnload{ 0, 1440 };
 
       constexpr Settings::SettingRange<int> inputSequenceInterval{ 100, 950 };
+      constexpr Settings::SettingRange<int> holdMoveInterval{ 10, 200 };
     } // end namespace ranges
   } // end namespace settings
 
+  // -----------------------------------------------------------------------------------------------
+  namespace flushing {
+    constexpr int quietPeriodMs = 500; // write changes after no further change for this long
+    constexpr int maxDelayMs = 5000;   // but not later than this after the first change
+    constexpr qint64 rateWindowMs = 60 * 1000;
+  } // end namespace flushing
+
   // -----------------------------------------------------------------------------------------------
   bool toBool(const QString& value) {
     return (value.toLower() == "true" || value.toLower() == "on" || value.toInt() > 0);
@@ -106,6 +143,104 @@ namespace {
       .arg(logging::hexId(dId.vendorId), logging::hexId(dId.productId), key);
   }
 
+  // -----------------------------------------------------------------------------------------------
+  // Actions with a state shared by all devices use the global instances.
+  void useGlobalActions(InputMapConfig& cfg)
+  {
+    for (auto& item : cfg)
+    {
+      auto& mappedAction = item.second;
+      if (mappedAction.action->type() == Action::Type::ScrollHorizontal) {
+        mappedAction.action = GlobalActions::scrollHorizontal();
+      } else if (mappedAction.action->type() == Action::Type::ScrollVertical) {
+        mappedAction.action = GlobalActions::scrollVertical();
+      } else if (mappedAction.action->type() == Action::Type::VolumeControl) {
+        mappedAction.action = GlobalActions::volumeControl();
+      }
+    }
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  using FileEntries = std::map<QString, QString>;
+
+  // -----------------------------------------------------------------------------------------------
+  // Entries of an INI settings file as written in the file, 'group/key' -> value. Only used to
+  // find the changed settings, the values themselves are read with QSettings.
+  FileEntries readFileEntries(const QString& fileName)
+  {
+    FileEntries entries;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) { return entries; }
+
+    QString group;
+    while (!file.atEnd())
+    {
+      const auto line = QString::fromUtf8(file.readLine()).trimmed();
+      if (line.isEmpty() || line.startsWith(';')) { continue; }
+
+      if (line.startsWith('[') && line.endsWith(']'))
+      {
+        group = QUrl::fromPercentEncoding(line.mid(1, line.size() - 2).toUtf8());
+        if (group == "General") { group.clear(); }
+        continue;
+      }
+
+      const auto eq = line.indexOf('=');
+      if (eq < 0) { continue; }
+      const auto key = QUrl::fromPercentEncoding(line.left(eq).trimmed().toUtf8()).replace('\\', '/');
+      entries.emplace(group.isEmpty() ? key : group + '/' + key, line.mid(eq + 1).trimmed());
+    }
+    return entries;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QStringList changedKeys(const FileEntries& before, const FileEntries& after)
+  {
+    QStringList keys;
+    for (const auto& entry : after)
+    {
+      const auto it = before.find(entry.first);
+      if (it == before.cend() || it->second != entry.second) { keys.push_back(entry.first); }
+    }
+    for (const auto& entry : before) {
+      if (after.count(entry.first) == 0) { keys.push_back(entry.first); }
+    }
+    return keys;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  // Raw entries of the settings array arrayKey as written in the file. Input map stores are bound
+  // to the checksum of these, i.e. a store is not used anymore if the file is edited.
+  QByteArray arrayEntries(const FileEntries& entries, const QString& arrayKey)
+  {
+    QByteArray data;
+    const auto prefix = arrayKey + '/';
+    for (auto it = entries.lower_bound(prefix);
+         it != entries.cend() && it->first.startsWith(prefix); ++it) {
+      data.append(it->first.toUtf8()).append('=').append(it->second.toUtf8()).append('\n');
+    }
+    return data;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  void replaceArrayEntries(FileEntries& entries, const FileEntries& from, const QString& arrayKey)
+  {
+    const auto prefix = arrayKey + '/';
+    auto it = entries.lower_bound(prefix);
+    while (it != entries.end() && it->first.startsWith(prefix)) { it = entries.erase(it); }
+    for (auto f = from.lower_bound(prefix); f != from.cend() && f->first.startsWith(prefix); ++f) {
+      entries.insert(*f);
+    }
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  std::pair<qint64, qint64> fileStat(const QString& fileName)
+  {
+    const QFileInfo fi(fileName);
+    if (!fi.exists()) { return {-1, -1}; }
+    return {fi.size(), fi.lastModified().toMSecsSinceEpoch()};
+  }
+
   // -------------------------------------------------------------------------------------------------
   auto loadPresets(QSettings* settings)
   {
@@ -143,11 +278,23 @@ Settings::Settings(const QString& configFile, QObject* parent)
 }
 
 // -------------------------------------------------------------------------------------------------
-Settings::~Settings() = default;
+Settings::~Settings()
+{
+  flush();
+}
 
 // -------------------------------------------------------------------------------------------------
 void Settings::init()
 {
+  // Changes are collected by QSettings in memory and written to the file by flush() after a
+  // quiet period, instead of with the next event loop iteration after every single change.
+  m_flushClock.start();
+  m_flushTimer = new QTimer(this);
+  m_flushTimer->setSingleShot(true);
+  connect(m_flushTimer, &QTimer::timeout, this, &Settings::flush);
+  m_settings->installEventFilter(this);
+  connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &Settings::flush);
+
   const QFileInfo fi(m_settings->fileName());
 
   if (!fi.isReadable()) {
@@ -160,7 +307,151 @@ void Settings::init()
 
   shapeSettingsInitialize();
   load();
+  loadApplicationSettings();
   initializeStringProperties();
+
+  m_fileEntries = readFileEntries(m_settings->fileName());
+  m_reloadTimer = new QTimer(this);
+  m_reloadTimer->setSingleShot(true);
+  m_reloadTimer->setInterval(250); // config management tools may write the file in several steps
+  connect(m_reloadTimer, &QTimer::timeout, this, &Settings::reload);
+  setupFileInotify();
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::loadApplicationSettings()
+{
+  setHoldMoveInterval(m_settings->value(::settings::holdMoveInterval,
+                                        ::settings::defaultValue::holdMoveInterval).toInt());
+  setSpotPrediction(m_settings->value(::settings::spotPrediction,
+                                      ::settings::defaultValue::spotPrediction).toBool());
+  setSpanningOverlayEnabled(m_settings->value(::settings::spanningOverlay,
+                                              ::settings::defaultValue::spanningOverlay).toBool());
+  setCompactOverlayEnabled(m_settings->value(::settings::compactOverlay,
+                                             ::settings::defaultValue::compactOverlay).toBool());
+  setOverlayIdleUnload(m_settings->value(::settings::overlayIdleUnload,
+                                         ::settings::defaultValue::overlayIdleUnload).toInt());
+  setZoomLiveRate(m_settings->value(::settings::zoomLiveRate,
+                                    ::settings::defaultValue::zoomLiveRate).toInt());
+}
+
+// -------------------------------------------------------------------------------------------------
+bool Settings::setupFileInotify()
+{
+  // Watch the directory, the file itself is usually replaced and not modified in place.
+  const QFileInfo fi(m_settings->fileName());
+  const auto notifier = inotify::watch(fi.absolutePath(), IN_CLOSE_WRITE | IN_MOVED_TO, this,
+  [this, fileName = fi.fileName()](uint32_t, const QString& name)
+  {
+    if (name == fileName) { m_reloadTimer->start(); }
+  });
+
+  if (!notifier) {
+    logWarning(lcSettings) << tr("inotify watch for '%1' failed. Changes to the settings file "
+                                 "will not be reloaded.").arg(fi.absolutePath());
+    return false;
+  }
+  return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::reload()
+{
+  if (m_reloadRunning) {
+    m_reloadTimer->start(); // again after the running reload
+    return;
+  }
+  if (m_flushedFileStat.first >= 0 && fileStat(m_settings->fileName()) == m_flushedFileStat) {
+    return; // Notification about our own flush()
+  }
+  m_reloadRunning = true;
+  flush(); // QSettings merges own changes with the changes in the file
+
+  // Parse and compare the file on a separate thread. Reading the file with another QSettings
+  // object also updates the data that all QSettings objects of the same file share.
+  std::thread([fileName = m_settings->fileName(), format = m_settings->format(),
+               before = m_fileEntries, context = QPointer<Settings>(this)]()
+  {
+    {
+      QSettings settings(fileName, format);
+      settings.sync();
+    }
+    auto after = readFileEntries(fileName);
+    auto keys = changedKeys(before, after);
+
+    const auto app = QCoreApplication::instance();
+    if (!app) { return; }
+
+    async::invoke(app, [context, after = std::move(after), keys = std::move(keys)]() mutable
+    {
+      if (!context) { return; }
+      context->m_reloadRunning = false;
+      context->m_fileEntries = std::move(after);
+      context->applyChangedKeys(keys);
+    });
+  }).detach();
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::applyChangedKeys(const QStringList& keys)
+{
+  if (keys.isEmpty()) { return; }
+  logDebug(lcSettings) << tr("Settings file changed: %1").arg(keys.join(", "));
+
+  bool applicationSettingsChanged = false;
+  std::set<QString> presets;
+  std::set<QString> deviceGroups;
+  std::set<QString> inputMapGroups;
+  for (const auto& key : keys)
+  {
+    const auto group = key.section('/', 0, 0, QString::SectionSkipEmpty);
+    if (!key.contains('/') || group.startsWith("Shape.")) {
+      applicationSettingsChanged = true;
+    } else if (group.startsWith(SETTINGS_PRESET_PREFIX)) {
+      presets.insert(group.mid(sizeof(SETTINGS_PRESET_PREFIX)-1));
+    } else if (group.startsWith("Device_")) {
+      deviceGroups.insert(group);
+      if (key.section('/', 1, 1) == ::settings::inputMapConfig) { inputMapGroups.insert(group); }
+    }
+  }
+
+  if (applicationSettingsChanged)
+  {
+    load();
+    loadApplicationSettings();
+  }
+
+  const auto presetGroups = m_settings->childGroups();
+  for (const auto& preset : presets)
+  {
+    const bool exists = presetGroups.contains(presetSection(preset, false));
+    if (exists && !m_presetModel->hasPreset(preset)) { m_presetModel->addPreset(preset); }
+    else if (!exists && m_presetModel->hasPreset(preset)) { m_presetModel->removePreset(preset); }
+  }
+
+  for (const auto& group : deviceGroups)
+  {
+    // Device groups, e.g. 'Device_046d_c53e', see settingsKey()
+    const auto parts = group.split('_');
+    if (parts.size() != 3) { continue; }
+
+    DeviceId dId;
+    bool vendorOk = false, productOk = false;
+    dId.vendorId = parts[1].toUShort(&vendorOk, 16);
+    dId.productId = parts[2].toUShort(&productOk, 16);
+    if (!vendorOk || !productOk) { continue; }
+
+    if (inputMapGroups.count(group))
+    { // Input map changed in the settings file, the input map store is outdated.
+      InputMapConfig cfg;
+      readDeviceInputMapConfig(dId, cfg);
+      writeInputMapStore(dId, cfg);
+    }
+    emit deviceSettingsChanged(dId);
+  }
+
+  logInfo(lcSettings) << tr("Reloaded %1 changed setting(s) from '%2'.")
+                         .arg(keys.size()).arg(m_settings->fileName());
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -172,9 +463,18 @@ void Settings::initializeStringProperties()
                     [this](const QString& value){ setOverlayDisabled(!toBool(value)); } } );
   map.emplace_back( "spot.multi-screen", StringProperty{ StringProperty::Bool, {false, true},
                     [this](const QString& value){ setMultiScreenOverlayEnabled(toBool(value)); } } );
+  map.emplace_back( "spot.spanning-overlay", StringProperty{ StringProperty::Bool, {false, true},
+                    [this](const QString& value){ setSpanningOverlayEnabled(toBool(value)); } } );
+  map.emplace_back( "spot.compact-overlay", StringProperty{ StringProperty::Bool, {false, true},
+                    [this](const QString& value){ setCompactOverlayEnabled(toBool(value)); } } );
+  map.emplace_back( "spot.idle-unload", StringProperty{ StringProperty::Integer,
+                    {::settings::ranges::overlayIdleUnload.min, ::settings::ranges::overlayIdleUnload.max},
+                    [this](const QString& value){ setOverlayIdleUnload(value.toInt()); } } );
   map.emplace_back( "spot.size", StringProperty{ StringProperty::Integer,
                     {::settings::ranges::spotSize.min, ::settings::ranges::spotSize.max},
                     [this](const QString& value){ setSpotSize(value.toInt()); } } );
+  map.emplace_back( "spot.prediction", StringProperty{ StringProperty::Bool, {false, true},
+                    [this](const QString& value){ setSpotPrediction(toBool(value)); } } );
   map.emplace_back( "spot.rotation", StringProperty{ StringProperty::Double,
                     {::settings::ranges::spotRotation.min, ::settings::ranges::spotRotation.max},
                     [this](const QString& value){ setSpotRotation(value.toDouble()); } } );
@@ -252,6 +552,13 @@ void Settings::initializeStringProperties()
   map.emplace_back( "zoom.factor", StringProperty{ StringProperty::Double,
                     {::settings::ranges::zoomFactor.min, ::settings::ranges::zoomFactor.max},
                     [this](const QString& value){ setZoomFactor(value.toDouble()); } } );
+  map.emplace_back( "zoom.live.rate", StringProperty{ StringProperty::Integer,
+                    {::settings::ranges::zoomLiveRate.min, ::settings::ranges::zoomLiveRate.max},
+                    [this](const QString& value){ setZoomLiveRate(value.toInt()); } } );
+  // --- input
+  map.emplace_back( "input.holdmove.interval", StringProperty{ StringProperty::Integer,
+                    {::settings::ranges::holdMoveInterval.min, ::settings::ranges::holdMoveInterval.max},
+                    [this](const QString& value){ setHoldMoveInterval(value.toInt()); } } );
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -269,7 +576,10 @@ const Settings::SettingRange<double>& Settings::spotRotationRange() { return ::s
 const Settings::SettingRange<int>& Settings::borderSizeRange() { return settings::ranges::borderSize; }
 const Settings::SettingRange<double>& Settings::borderOpacityRange() { return settings::ranges::borderOpacity; }
 const Settings::SettingRange<double>& Settings::zoomFactorRange() { return settings::ranges::zoomFactor; }
+const Settings::SettingRange<int>& Settings::zoomLiveRateRange() { return settings::ranges::zoomLiveRate; }
+const Settings::SettingRange<int>& Settings::overlayIdleUnloadRange() { return settings::ranges::overlayIdleUnload; }
 const Settings::SettingRange<int>& Settings::inputSequenceIntervalRange() { return settings::ranges::inputSequenceInterval; }
+const Settings::SettingRange<int>& Settings::holdMoveIntervalRange() { return settings::ranges::holdMoveInterval; }
 
 // -------------------------------------------------------------------------------------------------
 const QList<Settings::SpotShape>& Settings::spotShapes()
@@ -382,7 +692,7 @@ void Settings::shapeSettingsSavePreset(const QString& preset)
       {
         const QString& key = settingDefinition.settingsKey();
         const QString settingsKey = section + QString("Shape.%1/%2").arg(shape.name()).arg(key);
-        m_settings->setValue(settingsKey, propertyMap->property(key.toLocal8Bit()));
+        writeValue(settingsKey, propertyMap->property(key.toLocal8Bit()));
       }
     }
   }
@@ -421,7 +731,7 @@ void Settings::shapeSettingsInitialize()
             }
             logDebug(lcSettings) << QString("spot.shape.%1.%2 = ").arg(shape.name().toLower(), it->settingsKey())
                                  << setValue;
-            m_settings->setValue(QString("Shape.%1/%2").arg(shape.name()).arg(key), newValue);
+            writeValue(QString("Shape.%1/%2").arg(shape.name()).arg(key), newValue);
           }
         }
       });
@@ -445,7 +755,7 @@ void Settings::loadPreset(const QString& preset)
 void Settings::removePreset(const QString& preset)
 {
   m_presetModel->removePreset(preset);
-  m_settings->remove(presetSection(preset, false));
+  removeValue(presetSection(preset, false));
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -493,37 +803,106 @@ void Settings::savePreset(const QString& preset)
 {
   const auto section = presetSection(preset);
 
-  m_settings->setValue(section+::settings::showSpotShade, m_showSpotShade);
-  m_settings->setValue(section+::settings::spotSize, m_spotSize);
-  m_settings->setValue(section+::settings::showCenterDot, m_showCenterDot);
-  m_settings->setValue(section+::settings::dotSize, m_dotSize);
-  m_settings->setValue(section+::settings::dotColor, m_dotColor);
-  m_settings->setValue(section+::settings::dotOpacity, m_dotOpacity);
-  m_settings->setValue(section+::settings::shadeColor, m_shadeColor);
-  m_settings->setValue(section+::settings::shadeOpacity, m_shadeOpacity);
-  m_settings->setValue(section+::settings::cursor, static_cast<int>(m_cursor));
-  m_settings->setValue(section+::settings::spotShape, m_spotShape);
-  m_settings->setValue(section+::settings::spotRotation, m_spotRotation);
-  m_settings->setValue(section+::settings::showBorder, m_showBorder);
-  m_settings->setValue(section+::settings::borderColor, m_borderColor);
-  m_settings->setValue(section+::settings::borderSize, m_borderSize);
-  m_settings->setValue(section+::settings::borderOpacity, m_borderOpacity);
-  m_settings->setValue(section+::settings::zoomEnabled, m_zoomEnabled);
-  m_settings->setValue(section+::settings::zoomFactor, m_zoomFactor);
-  m_settings->setValue(section+::settings::multiScreenOverlay, m_multiScreenOverlayEnabled);
+  writeValue(section+::settings::showSpotShade, m_showSpotShade);
+  writeValue(section+::settings::spotSize, m_spotSize);
+  writeValue(section+::settings::showCenterDot, m_showCenterDot);
+  writeValue(section+::settings::dotSize, m_dotSize);
+  writeValue(section+::settings::dotColor, m_dotColor);
+  writeValue(section+::settings::dotOpacity, m_dotOpacity);
+  writeValue(section+::settings::shadeColor, m_shadeColor);
+  writeValue(section+::settings::shadeOpacity, m_shadeOpacity);
+  writeValue(section+::settings::cursor, static_cast<int>(m_cursor));
+  writeValue(section+::settings::spotShape, m_spotShape);
+  writeValue(section+::settings::spotRotation, m_spotRotation);
+  writeValue(section+::settings::showBorder, m_showBorder);
+  writeValue(section+::settings::borderColor, m_borderColor);
+  writeValue(section+::settings::borderSize, m_borderSize);
+  writeValue(section+::settings::borderOpacity, m_borderOpacity);
+  writeValue(section+::settings::zoomEnabled, m_zoomEnabled);
+  writeValue(section+::settings::zoomFactor, m_zoomFactor);
+  writeValue(section+::settings::multiScreenOverlay, m_multiScreenOverlayEnabled);
   shapeSettingsSavePreset(preset);
 
   m_presetModel->addPreset(preset);
   emit presetLoaded(preset);
 }
 
+// -------------------------------------------------------------------------------------------------
+void Settings::writeValue(const QString& key, const QVariant& value)
+{
+  m_settings->setValue(key, value);
+  m_pendingChanges = true;
+  scheduleFlush();
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::removeValue(const QString& key)
+{
+  m_settings->remove(key);
+  m_pendingChanges = true;
+  scheduleFlush();
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::scheduleFlush()
+{
+  if (!m_flushTimer->isActive()) { m_firstPendingChange = m_flushClock.elapsed(); }
+  const auto remaining = flushing::maxDelayMs - (m_flushClock.elapsed() - m_firstPendingChange);
+  m_flushTimer->start(static_cast<int>(qBound<qint64>(0, remaining, flushing::quietPeriodMs)));
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::flush()
+{
+  m_flushTimer->stop();
+  m_firstPendingChange = -1;
+  if (!m_pendingChanges) { return; }
+
+  // QSettings writes the file atomically, i.e. to a temporary file that replaces the original.
+  m_settings->sync();
+  m_pendingChanges = false;
+  if (m_settings->status() != QSettings::NoError) {
+    logWarning(lcSettings) << tr("Could not write settings file '%1'.").arg(m_settings->fileName());
+  } else {
+    m_flushedFileStat = fileStat(m_settings->fileName());
+  }
+  writeDirtyInputMapStores();
+
+  const auto now = m_flushClock.elapsed();
+  m_flushTimes.push_back(now);
+  while (m_flushTimes.front() < now - flushing::rateWindowMs) { m_flushTimes.pop_front(); }
+  logDebug(lcSettings) << tr("Settings written, %1 time(s) in the last minute.").arg(m_flushTimes.size());
+}
+
+// -------------------------------------------------------------------------------------------------
+int Settings::flushesPerMinute() const
+{
+  const auto since = m_flushClock.elapsed() - flushing::rateWindowMs;
+  return static_cast<int>(std::count_if(m_flushTimes.cbegin(), m_flushTimes.cend(),
+                                        [since](qint64 t){ return t >= since; }));
+}
+
+// -------------------------------------------------------------------------------------------------
+bool Settings::eventFilter(QObject* watched, QEvent* event)
+{
+  // QSettings posts an update request to itself after a change, it would write the file
+  // on the next event loop iteration. Changes are written by flush() instead.
+  if (watched == m_settings && event->type() == QEvent::UpdateRequest)
+  {
+    m_pendingChanges = true;
+    if (!m_flushTimer->isActive()) { scheduleFlush(); }
+    return true;
+  }
+  return QObject::eventFilter(watched, event);
+}
+
 // -------------------------------------------------------------------------------------------------
 void Settings::setShowSpotShade(bool show)
 {
   if (show == m_showSpotShade) { return; }
 
   m_showSpotShade = show;
-  m_settings->setValue(::settings::showSpotShade, m_showSpotShade);
+  writeValue(::settings::showSpotShade, m_showSpotShade);
   logDebug(lcSettings) << "shade =" << m_showSpotShade;
   emit showSpotShadeChanged(m_showSpotShade);
 }
@@ -534,7 +913,7 @@ void Settings::setSpotSize(int size)
   if (size == m_spotSize) { return; }
 
   m_spotSize = qMin(qMax(::settings::ranges::spotSize.min, size), ::settings::ranges::spotSize.max);
-  m_settings->setValue(::settings::spotSize, m_spotSize);
+  writeValue(::settings::spotSize, m_spotSize);
   logDebug(lcSettings) << "spot.size =" << m_spotSize;
   emit spotSizeChanged(m_spotSize);
 }
@@ -545,7 +924,7 @@ void Settings::setShowCenterDot(bool show)
   if (show == m_showCenterDot) { return; }
 
   m_showCenterDot = show;
-  m_settings->setValue(::settings::showCenterDot, m_showCenterDot);
+  writeValue(::settings::showCenterDot, m_showCenterDot);
   logDebug(lcSettings) << "dot =" << m_showCenterDot;
   emit showCenterDotChanged(m_showCenterDot);
 }
@@ -556,7 +935,7 @@ void Settings::setDotSize(int size)
   if (size == m_dotSize) { return; }
 
   m_dotSize = qMin(qMax(::settings::ranges::dotSize.min, size), ::settings::ranges::dotSize.max);
-  m_settings->setValue(::settings::dotSize, m_dotSize);
+  writeValue(::settings::dotSize, m_dotSize);
   logDebug(lcSettings) << "dot.size =" << m_dotSize;
   emit dotSizeChanged(m_dotSize);
 }
@@ -567,7 +946,7 @@ void Settings::setDotColor(const QColor& color)
   if (color == m_dotColor) { return; }
 
   m_dotColor = color;
-  m_settings->setValue(::settings::dotColor, m_dotColor);
+  writeValue(::settings::dotColor, m_dotColor);
   logDebug(lcSettings) << "dot.color =" << m_dotColor.name();
   emit dotColorChanged(m_dotColor);
 }
@@ -578,7 +957,7 @@ void Settings::setDotOpacity(double opacity)
   if (opacity > m_dotOpacity || opacity < m_dotOpacity)
   {
     m_dotOpacity = qMin(qMax(::settings::ranges::dotOpacity.min, opacity), ::settings::ranges::dotOpacity.max);
-    m_settings->setValue(::settings::dotOpacity, m_dotOpacity);
+    writeValue(::settings::dotOpacity, m_dotOpacity);
     logDebug(lcSettings) << "dot.opacity = " << m_dotOpacity;
     emit dotOpacityChanged(m_dotOpacity);
   }
@@ -590,7 +969,7 @@ void Settings::setShadeColor(const QColor& color)
   if (color == m_shadeColor) { return; }
 
   m_shadeColor = color;
-  m_settings->setValue(::settings::shadeColor, m_shadeColor);
+  writeValue(::settings::shadeColor, m_shadeColor);
   logDebug(lcSettings) << "shade.color =" << m_shadeColor.name();
   emit shadeColorChanged(m_shadeColor);
 }
@@ -601,7 +980,7 @@ void Settings::setShadeOpacity(double opacity)
   if (opacity > m_shadeOpacity || opacity < m_shadeOpacity)
   {
     m_shadeOpacity = qMin(qMax(::settings::ranges::shadeOpacity.min, opacity), ::settings::ranges::shadeOpacity.max);
-    m_settings->setValue(::settings::shadeOpacity, m_shadeOpacity);
+    writeValue(::settings::shadeOpacity, m_shadeOpacity);
     logDebug(lcSettings) << "shade.opacity = " << m_shadeOpacity;
     emit shadeOpacityChanged(m_shadeOpacity);
   }
@@ -613,7 +992,7 @@ void Settings::setCursor(Qt::CursorShape cursor)
   if (cursor == m_cursor) { return; }
 
   m_cursor = qMin(qMax(static_cast<Qt::CursorShape>(0), cursor), Qt::LastCursor);
-  m_settings->setValue(::settings::cursor, static_cast<int>(m_cursor));
+  writeValue(::settings::cursor, static_cast<int>(m_cursor));
   logDebug(lcSettings) << "cursor = " << m_cursor;
   emit cursorChanged(m_cursor);
 }
@@ -630,7 +1009,7 @@ void Settings::setSpotShape(const QString& spotShapeQmlComponent)
 
   if (it != spotShapes().cend()) {
     m_spotShape = it->qmlComponent();
-    m_settings->setValue(::settings::spotShape, m_spotShape);
+    writeValue(::settings::spotShape, m_spotShape);
     logDebug(lcSettings) << "spot.shape = " << m_spotShape;
     emit spotShapeChanged(m_spotShape);
     setSpotRotationAllowed(it->allowRotation());
@@ -643,7 +1022,7 @@ void Settings::setSpotRotation(double rotation)
   if (rotation > m_spotRotation || rotation < m_spotRotation)
   {
     m_spotRotation = qMin(qMax(::settings::ranges::spotRotation.min, rotation), ::settings::ranges::spotRotation.max);
-    m_settings->setValue(::settings::spotRotation, m_spotRotation);
+    writeValue(::settings::spotRotation, m_spotRotation);
     logDebug(lcSettings) << "spot.rotation = " << m_spotRotation;
     emit spotRotationChanged(m_spotRotation);
   }
@@ -699,7 +1078,7 @@ void Settings::setShowBorder(bool show)
   if (show == m_showBorder) { return; }
 
   m_showBorder = show;
-  m_settings->setValue(::settings::showBorder, m_showBorder);
+  writeValue(::settings::showBorder, m_showBorder);
   logDebug(lcSettings) << "border = " << m_showBorder;
   emit showBorderChanged(m_showBorder);
 }
@@ -710,7 +1089,7 @@ void Settings::setBorderColor(const QColor& color)
   if (color == m_borderColor) { return; }
 
   m_borderColor = color;
-  m_settings->setValue(::settings::borderColor, m_borderColor);
+  writeValue(::settings::borderColor, m_borderColor);
   logDebug(lcSettings) << "border.color = " << m_borderColor.name();
   emit borderColorChanged(m_borderColor);
 }
@@ -721,7 +1100,7 @@ void Settings::setBorderSize(int size)
   if (size == m_borderSize) { return; }
 
   m_borderSize = qMin(qMax(::settings::ranges::borderSize.min, size), ::settings::ranges::borderSize.max);
-  m_settings->setValue(::settings::borderSize, m_borderSize);
+  writeValue(::settings::borderSize, m_borderSize);
   logDebug(lcSettings) << "border.size = " << m_borderSize;
   emit borderSizeChanged(m_borderSize);
 }
@@ -732,7 +1111,7 @@ void Settings::setBorderOpacity(double opacity)
   if (opacity > m_borderOpacity || opacity < m_borderOpacity)
   {
     m_borderOpacity = qMin(qMax(::settings::ranges::borderOpacity.min, opacity), ::settings::ranges::borderOpacity.max);
-    m_settings->setValue(::settings::borderOpacity, m_borderOpacity);
+    writeValue(::settings::borderOpacity, m_borderOpacity);
     logDebug(lcSettings) << "border.opacity = " << m_borderOpacity;
     emit borderOpacityChanged(m_borderOpacity);
   }
@@ -744,7 +1123,7 @@ void Settings::setZoomEnabled(bool enabled)
   if (enabled == m_zoomEnabled) { return; }
 
   m_zoomEnabled = enabled;
-  m_settings->setValue(::settings::zoomEnabled, m_zoomEnabled);
+  writeValue(::settings::zoomEnabled, m_zoomEnabled);
   logDebug(lcSettings) << "zoom = " << m_zoomEnabled;
   emit zoomEnabledChanged(m_zoomEnabled);
 }
@@ -755,7 +1134,7 @@ void Settings::setZoomFactor(double factor)
   if (factor > m_zoomFactor || factor < m_zoomFactor)
   {
     m_zoomFactor = qMin(qMax(::settings::ranges::zoomFactor.min, factor), ::settings::ranges::zoomFactor.max);
-    m_settings->setValue(::settings::zoomFactor, m_zoomFactor);
+    writeValue(::settings::zoomFactor, m_zoomFactor);
     logDebug(lcSettings) << "zoom.factor = " << m_zoomFactor;
     emit zoomFactorChanged(m_zoomFactor);
   }
@@ -766,7 +1145,7 @@ void Settings::setMultiScreenOverlayEnabled(bool enabled)
 {
     if (m_multiScreenOverlayEnabled == enabled) { return; }
     m_multiScreenOverlayEnabled = enabled;
-    m_settings->setValue(::settings::multiScreenOverlay, m_multiScreenOverlayEnabled);
+    writeValue(::settings::multiScreenOverlay, m_multiScreenOverlayEnabled);
     logDebug(lcSettings) << "multi-screen-overlay = " << m_multiScreenOverlayEnabled;
     emit multiScreenOverlayEnabledChanged(m_multiScreenOverlayEnabled);
 }
@@ -779,6 +1158,78 @@ void Settings::setOverlayDisabled(bool disabled)
   emit overlayDisabledChanged(m_overlayDisabled);
 }
 
+// -------------------------------------------------------------------------------------------------
+void Settings::setSpotPrediction(bool enabled)
+{
+  if (m_spotPrediction == enabled) { return; }
+
+  m_spotPrediction = enabled;
+  writeValue(::settings::spotPrediction, m_spotPrediction);
+  logDebug(lcSettings) << "spot.prediction = " << m_spotPrediction;
+  emit spotPredictionChanged(m_spotPrediction);
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::setSpanningOverlayEnabled(bool enabled)
+{
+  if (m_spanningOverlayEnabled == enabled) { return; }
+
+  m_spanningOverlayEnabled = enabled;
+  writeValue(::settings::spanningOverlay, m_spanningOverlayEnabled);
+  logDebug(lcSettings) << "spot.spanning-overlay = " << m_spanningOverlayEnabled;
+  emit spanningOverlayEnabledChanged(m_spanningOverlayEnabled);
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::setCompactOverlayEnabled(bool enabled)
+{
+  if (m_compactOverlayEnabled == enabled) { return; }
+
+  m_compactOverlayEnabled = enabled;
+  writeValue(::settings::compactOverlay, m_compactOverlayEnabled);
+  logDebug(lcSettings) << "spot.compact-overlay = " << m_compactOverlayEnabled;
+  emit compactOverlayEnabledChanged(m_compactOverlayEnabled);
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::setZoomLiveRate(int rate)
+{
+  const auto r = qMin(qMax(::settings::ranges::zoomLiveRate.min, rate),
+                      ::settings::ranges::zoomLiveRate.max);
+  if (r == m_zoomLiveRate) { return; }
+
+  m_zoomLiveRate = r;
+  writeValue(::settings::zoomLiveRate, m_zoomLiveRate);
+  logDebug(lcSettings) << "zoom.live.rate = " << m_zoomLiveRate;
+  emit zoomLiveRateChanged(m_zoomLiveRate);
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::setOverlayIdleUnload(int minutes)
+{
+  const auto m = qMin(qMax(::settings::ranges::overlayIdleUnload.min, minutes),
+                      ::settings::ranges::overlayIdleUnload.max);
+  if (m == m_overlayIdleUnload) { return; }
+
+  m_overlayIdleUnload = m;
+  writeValue(::settings::overlayIdleUnload, m_overlayIdleUnload);
+  logDebug(lcSettings) << "spot.idle-unload = " << m_overlayIdleUnload;
+  emit overlayIdleUnloadChanged(m_overlayIdleUnload);
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::setHoldMoveInterval(int intervalMs)
+{
+  const auto interval = qMin(qMax(::settings::ranges::holdMoveInterval.min, intervalMs),
+                             ::settings::ranges::holdMoveInterval.max);
+  if (interval == m_holdMoveInterval) { return; }
+
+  m_holdMoveInterval = interval;
+  writeValue(::settings::holdMoveInterval, m_holdMoveInterval);
+  logDebug(lcSettings) << "input.holdmove.interval = " << m_holdMoveInterval;
+  emit holdMoveIntervalChanged(m_holdMoveInterval);
+}
+
 // -------------------------------------------------------------------------------------------------
 QString Settings::StringProperty::typeToString(Type type)
 {
@@ -797,7 +1248,7 @@ void Settings::setDeviceInputSeqInterval(const DeviceId& dId, int intervalMs)
 {
   const auto v = qMin(qMax(::settings::ranges::inputSequenceInterval.min, intervalMs),
                            ::settings::ranges::inputSequenceInterval.max);
-  m_settings->setValue(settingsKey(dId, ::settings::inputSequenceInterval), v);
+  writeValue(settingsKey(dId, ::settings::inputSequenceInterval), v);
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -819,24 +1270,94 @@ void Settings::setDeviceInputMapConfig(const DeviceId& dId, const InputMapConfig
   for (const auto& item : imc)
   {
     m_settings->setArrayIndex(index++);
-    m_settings->setValue("deviceSequence", QVariant::fromValue(item.first));
-    m_settings->setValue("mappedAction", QVariant::fromValue(item.second));
+    writeValue("deviceSequence", QVariant::fromValue(item.first));
+    writeValue("mappedAction", QVariant::fromValue(item.second));
   }
   m_settings->endArray();
 
   // Remove old entries...
   m_settings->beginGroup(settingsKey(dId, ::settings::inputMapConfig));
   for (; index < sizeBefore; ++index) {
-    m_settings->remove(QString::number(index+1));
+    removeValue(QString::number(index+1));
   }
   m_settings->endGroup();
+
+  // The store is bound to the entries in the file, it is written by flush() after them.
+  m_dirtyInputMapStores[dId] = std::make_shared<const InputMapConfig>(imc);
+  m_pendingChanges = true;
+  scheduleFlush();
 }
 
 // -------------------------------------------------------------------------------------------------
-InputMapConfig Settings::getDeviceInputMapConfig(const DeviceId& dId)
+QString Settings::inputMapStorePath(const DeviceId& dId) const
+{
+  // e.g. ~/.config/Projecteur/Projecteur-inputmaps/046d_c53e.bin
+  const QFileInfo fi(m_settings->fileName());
+  return QString("%1/%2-inputmaps/%3_%4.bin").arg(fi.absolutePath(), fi.completeBaseName(),
+                                                  logging::hexId(dId.vendorId),
+                                                  logging::hexId(dId.productId));
+}
+
+// -------------------------------------------------------------------------------------------------
+bool Settings::writeInputMapStore(const DeviceId& dId, const InputMapConfig& imc) const
+{
+  const auto source = arrayEntries(m_fileEntries, settingsKey(dId, ::settings::inputMapConfig));
+  return InputMapStore::save(inputMapStorePath(dId),
+                             InputMapStore::serialize(imc, InputMapStore::checksum(source)));
+}
+
+// -------------------------------------------------------------------------------------------------
+void Settings::writeDirtyInputMapStores()
+{
+  if (m_dirtyInputMapStores.empty()) { return; }
+
+  if (m_settings->status() != QSettings::NoError)
+  { // The stores would be bound to the outdated entries in the file.
+    for (const auto& dirty : m_dirtyInputMapStores) {
+      QFile::remove(inputMapStorePath(dirty.first));
+    }
+    m_dirtyInputMapStores.clear();
+    return;
+  }
+
+  // Only the entries of these input maps are taken over, other changes in the file are still
+  // found by reload().
+  const auto entries = readFileEntries(m_settings->fileName());
+  for (const auto& dirty : m_dirtyInputMapStores)
+  {
+    replaceArrayEntries(m_fileEntries, entries, settingsKey(dirty.first, ::settings::inputMapConfig));
+    writeInputMapStore(dirty.first, *dirty.second);
+  }
+  m_dirtyInputMapStores.clear();
+}
+
+// -------------------------------------------------------------------------------------------------
+InputMapConfig Settings::getDeviceInputMapConfig(const DeviceId& dId) const
 {
   InputMapConfig cfg;
+  QElapsedTimer timer;
+  timer.start();
+
+  // Only read here, stores are written by flush() after an input map is set and when precompiled.
+  const auto source = arrayEntries(m_fileEntries, settingsKey(dId, ::settings::inputMapConfig));
+  if (!source.isEmpty() && m_dirtyInputMapStores.count(dId) == 0
+      && InputMapStore::load(inputMapStorePath(dId), InputMapStore::checksum(source), cfg))
+  {
+    useGlobalActions(cfg);
+    logDebug(lcSettings) << tr("Input map (%1 items) loaded from store in %2 us.")
+                            .arg(cfg.size()).arg(timer.nsecsElapsed() / 1000);
+    return cfg;
+  }
+
+  readDeviceInputMapConfig(dId, cfg);
+  logDebug(lcSettings) << tr("Input map (%1 items) loaded from settings in %2 us.")
+                          .arg(cfg.size()).arg(timer.nsecsElapsed() / 1000);
+  return cfg;
+}
 
+// -------------------------------------------------------------------------------------------------
+bool Settings::readDeviceInputMapConfig(const DeviceId& dId, InputMapConfig& cfg) const
+{
   const int size = m_settings->beginReadArray(settingsKey(dId, ::settings::inputMapConfig));
   for (int i = 0; i < size; ++i)
   {
@@ -846,25 +1367,46 @@ InputMapConfig Settings::getDeviceInputMapConfig(const DeviceId& dId)
     const auto conf = m_settings->value("mappedAction");
     if (!conf.canConvert<MappedAction>()) { continue; }
     auto mappedAction = qvariant_cast<MappedAction>(conf);
-    if (mappedAction.action->type() == Action::Type::ScrollHorizontal) {
-      mappedAction.action = GlobalActions::scrollHorizontal();
-    } else if (mappedAction.action->type() == Action::Type::ScrollVertical) {
-      mappedAction.action = GlobalActions::scrollVertical();
-    } else if (mappedAction.action->type() == Action::Type::VolumeControl) {
-      mappedAction.action = GlobalActions::volumeControl();
-    }
+    if (!mappedAction.action) { continue; }
     cfg.emplace(qvariant_cast<KeyEventSequence>(seq), std::move(mappedAction));
   }
   m_settings->endArray();
+  useGlobalActions(cfg);
+  return size > 0;
+}
 
-  return cfg;
+// -------------------------------------------------------------------------------------------------
+int Settings::precompileInputMaps()
+{
+  int count = 0;
+  for (const auto& group : m_settings->childGroups())
+  {
+    // Device groups, e.g. 'Device_046d_c53e', see settingsKey()
+    const auto parts = group.split('_');
+    if (parts.size() != 3 || parts[0] != "Device") { continue; }
+
+    DeviceId dId;
+    bool vendorOk = false, productOk = false;
+    dId.vendorId = parts[1].toUShort(&vendorOk, 16);
+    dId.productId = parts[2].toUShort(&productOk, 16);
+    if (!vendorOk || !productOk) { continue; }
+
+    InputMapConfig cfg;
+    if (!readDeviceInputMapConfig(dId, cfg)) { continue; }
+    if (!writeInputMapStore(dId, cfg)) { return -1; }
+
+    logInfo(lcSettings) << tr("Input map store with %1 items written: %2")
+                           .arg(cfg.size()).arg(inputMapStorePath(dId));
+    ++count;
+  }
+  return count;
 }
 
 // -------------------------------------------------------------------------------------------------
 void Settings::setTimerSettings(const DeviceId& dId, int timerId, bool enabled, int seconds)
 {
-  m_settings->setValue(settingsKey(dId, QString(::settings::timerEnabled).arg(timerId)), enabled);
-  m_settings->setValue(settingsKey(dId, QString(::settings::timerSeconds).arg(timerId)), seconds);
+  writeValue(settingsKey(dId, QString(::settings::timerEnabled).arg(timerId)), enabled);
+  writeValue(settingsKey(dId, QString(::settings::timerSeconds).arg(timerId)), seconds);
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -880,8 +1422,8 @@ std::pair<bool, int> Settings::timerSettings(const DeviceId& dId, int timerId) c
 // -------------------------------------------------------------------------------------------------
 void Settings::setVibrationSettings(const DeviceId& dId, uint8_t len, uint8_t intensity)
 {
-  m_settings->setValue(settingsKey(dId, ::settings::vibrationLength), len);
-  m_settings->setValue(settingsKey(dId, ::settings::vibrationIntensity), intensity);
+  writeValue(settingsKey(dId, ::settings::vibrationLength), len);
+  writeValue(settingsKey(dId, ::settings::vibrationIntensity), intensity);
 }
 
 // -------------------------------------------------------------------------------------------------
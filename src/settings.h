@@ -2,19 +2,25 @@
 // - See LICENSE.md and README.md
 # pragma once
 
+#include "device-defs.h"
+
+#include <deque>
 #include <functional>
 #include <map>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include <QAbstractListModel>
 #include <QColor>
+#include <QElapsedTimer>
 #include <QVariant>
 
-struct DeviceId;
 class InputMapConfig;
 class PresetModel;
 class QSettings;
 class QQmlPropertyMap;
+class QTimer;
 
 // -------------------------------------------------------------------------------------------------
 class Settings : public QObject
@@ -88,6 +94,18 @@ public:
   void setMultiScreenOverlayEnabled(bool enabled);
   bool overlayDisabled() const { return m_overlayDisabled; }
   void setOverlayDisabled(bool disabled);
+  bool spotPrediction() const { return m_spotPrediction; }
+  void setSpotPrediction(bool enabled);
+  bool spanningOverlayEnabled() const { return m_spanningOverlayEnabled; }
+  void setSpanningOverlayEnabled(bool enabled);
+  bool compactOverlayEnabled() const { return m_compactOverlayEnabled; }
+  void setCompactOverlayEnabled(bool enabled);
+  int zoomLiveRate() const { return m_zoomLiveRate; }
+  void setZoomLiveRate(int rate);
+  int overlayIdleUnload() const { return m_overlayIdleUnload; }
+  void setOverlayIdleUnload(int minutes);
+  int holdMoveInterval() const { return m_holdMoveInterval; }
+  void setHoldMoveInterval(int intervalMs);
 
   template <typename T> struct SettingRange {
     const T min;
@@ -102,7 +120,10 @@ public:
   static const SettingRange<int>& borderSizeRange();
   static const SettingRange<double>& borderOpacityRange();
   static const SettingRange<double>& zoomFactorRange();
+  static const SettingRange<int>& zoomLiveRateRange();
+  static const SettingRange<int>& overlayIdleUnloadRange();
   static const SettingRange<int>& inputSequenceIntervalRange();
+  static const SettingRange<int>& holdMoveIntervalRange();
 
   class SpotShapeSetting {
   public:
@@ -170,7 +191,11 @@ public:
   void setDeviceInputSeqInterval(const DeviceId& dId, int intervalMs);
   int deviceInputSeqInterval(const DeviceId& dId) const;
   void setDeviceInputMapConfig(const DeviceId& dId, const InputMapConfig& imc);
-  InputMapConfig getDeviceInputMapConfig(const DeviceId& dId);
+  /// Input map of the device, from its input map store if it is up to date, see InputMapStore.
+  InputMapConfig getDeviceInputMapConfig(const DeviceId& dId) const;
+  /// Write the input map stores of all devices in the settings file,
+  /// returns the number of stores written or -1 on error.
+  int precompileInputMaps();
 
   void setTimerSettings(const DeviceId& dId, int timerId, bool enabled, int seconds);
   std::pair<bool, int> timerSettings(const DeviceId& dId, int timerId) const;
@@ -178,6 +203,14 @@ public:
   void setVibrationSettings(const DeviceId& dId, uint8_t len, uint8_t intensity);
   std::pair<uint8_t, uint8_t> vibrationSettings(const DeviceId& dId) const;
 
+  /// Write pending changes to the settings file now, otherwise done after a short quiet period.
+  void flush();
+  /// Number of times the settings file was written during the last minute.
+  int flushesPerMinute() const;
+
+protected:
+  bool eventFilter(QObject* watched, QEvent* event) override;
+
 signals:
   void showSpotShadeChanged(bool show);
   void spotSizeChanged(int size);
@@ -199,11 +232,31 @@ signals:
   void zoomFactorChanged(double zoomFactor);
   void multiScreenOverlayEnabledChanged(bool enabled);
   void overlayDisabledChanged(bool disabled);
+  void spotPredictionChanged(bool enabled);
+  void spanningOverlayEnabledChanged(bool enabled);
+  void compactOverlayEnabledChanged(bool enabled);
+  void zoomLiveRateChanged(int rate);
+  void overlayIdleUnloadChanged(int minutes);
+  void holdMoveIntervalChanged(int intervalMs);
 
   void presetLoaded(const QString& preset);
+  /// Settings of the device changed in the settings file, only vendor and product id are set.
+  void deviceSettingsChanged(const DeviceId& dId);
 
 private:
   QSettings* m_settings = nullptr;
+  QTimer* m_flushTimer = nullptr;
+  QElapsedTimer m_flushClock;
+  qint64 m_firstPendingChange = -1; ///< Time of the first change not written yet (m_flushClock).
+  bool m_pendingChanges = false;
+  std::deque<qint64> m_flushTimes; ///< Times of the writes during the last minute (m_flushClock).
+  QTimer* m_reloadTimer = nullptr;
+  bool m_reloadRunning = false;
+  /// Size and modification time (ms since epoch) of the settings file as written by flush().
+  std::pair<qint64, qint64> m_flushedFileStat{-1, -1};
+  std::map<QString, QString> m_fileEntries; ///< Settings file entries as last read, 'group/key' -> value.
+  /// Input maps set since the last flush(), their stores are written after the settings file.
+  std::map<DeviceId, std::shared_ptr<const InputMapConfig>> m_dirtyInputMapStores;
 
   PresetModel* m_presetModel;
   std::map<QString, QQmlPropertyMap*> m_shapeSettings;
@@ -229,11 +282,18 @@ private:
   bool m_showBorder = false;
   bool m_multiScreenOverlayEnabled = false;
   bool m_overlayDisabled = false;
+  bool m_spotPrediction = false; ///< Predict the spot position from device motion events.
+  bool m_spanningOverlayEnabled = false; ///< One overlay window for all screens (multi-screen, X11).
+  bool m_compactOverlayEnabled = false; ///< Overlay only covers the spot if the shade is off (X11).
+  int m_zoomLiveRate = 0; ///< Live zoom updates per second, 0: zoom shows the desktop at activation.
+  int m_overlayIdleUnload = 0; ///< Minutes without device and spot until the overlay is unloaded, 0: never.
+  int m_holdMoveInterval = 30; ///< Output interval (ms) for hold-move scroll/volume steps.
 
   std::vector<std::pair<QString, StringProperty>> m_stringPropertyMap;
 
 private:
   void init();
+  void loadApplicationSettings();
   void load(const QString& preset = QString());
   QObject* shapeSettingsRootObject();
   void shapeSettingsPopulateRoot();
@@ -243,6 +303,17 @@ private:
   void shapeSettingsSavePreset(const QString& preset);
   void setSpotRotationAllowed(bool allowed);
   void initializeStringProperties();
+  bool readDeviceInputMapConfig(const DeviceId& dId, InputMapConfig& cfg) const;
+  bool setupFileInotify();
+  /// Read the settings file again and apply the settings that changed in it.
+  void reload();
+  void applyChangedKeys(const QStringList& keys);
+  bool writeInputMapStore(const DeviceId& dId, const InputMapConfig& imc) const;
+  void writeDirtyInputMapStores();
+  QString inputMapStorePath(const DeviceId& dId) const;
+  void writeValue(const QString& key, const QVariant& value);
+  void removeValue(const QString& key);
+  void scheduleFlush();
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -0,0 +1,323 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+
+#include "spotcontroller.h"
+
+#include <QCursor>
+#include <QGuiApplication>
+#include <QMouseEvent>
+#include <QQuickWindow>
+#include <QScreen>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <limits>
+
+namespace {
+  // Duration of the fade in and out, same as the default QML PropertyAnimation.
+  constexpr qint64 fadeDuration = 250;
+
+  namespace prediction {
+    /// Number of device speed ranges with a separately learned pointer acceleration.
+    constexpr int gainBuckets = 8;
+    constexpr qreal minGain = 0.2;
+    constexpr qreal maxGain = 8.0;
+    constexpr qreal learnRate = 0.2;
+    /// Minimum confirmed device motion (device units) to learn the acceleration from.
+    constexpr qreal minLearnDistance = 4.0;
+    /// Motion without a confirming cursor sample is trusted after this time (ms)...
+    constexpr qint64 unconfirmedTimeout = 250;
+    /// ...or if there is more of it than this.
+    constexpr size_t maxPending = 128;
+
+    // ---------------------------------------------------------------------------------------------
+    // Speed range for device motion over the interval since the previous motion event.
+    int speedBucket(const QPointF& delta, qint64 intervalUs)
+    {
+      // Intervals above 50 ms are treated as the start of a new movement.
+      const qreal intervalMs = qBound<qint64>(1000, intervalUs, 50000) / 1000.0;
+      const qreal speed = std::hypot(delta.x(), delta.y()) / intervalMs; // device units per ms
+      return qBound(0, static_cast<int>(std::log2(1.0 + speed) * 2), gainBuckets - 1);
+    }
+  } // end namespace prediction
+
+  // -----------------------------------------------------------------------------------------------
+  QPointF globalPosition(const QMouseEvent* e)
+  {
+  #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return e->globalPosition();
+  #else
+    return e->screenPos();
+  #endif
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QPointF globalPosition(const QEnterEvent* e)
+  {
+  #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return e->globalPosition();
+  #else
+    return e->screenPos();
+  #endif
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QRectF desktopBounds()
+  {
+    const auto screen = QGuiApplication::primaryScreen();
+    return screen ? QRectF(screen->virtualGeometry()) : QRectF();
+  }
+} // end anonymous namespace
+
+// -------------------------------------------------------------------------------------------------
+/// Predicts the cursor position from relative device motion.
+///
+/// Device motion stays pending until a cursor sample arrives that includes it, which is assumed
+/// for motion received at least one display frame before the sample. The ratio between the
+/// cursor movement and the confirmed device motion is learned per device speed range, which
+/// models the pointer acceleration of the compositor.
+struct SpotController::Predictor
+{
+  struct Motion
+  {
+    QPointF delta;
+    int bucket;
+    qint64 receivedMs;
+  };
+
+  Predictor(qint64 confirmDelayMs, const QRectF& desktop)
+    : confirmDelay(confirmDelayMs), bounds(desktop)
+  {
+    gains.fill(1.0);
+  }
+
+  QPointF predicted() const
+  {
+    QPointF pos = base;
+    for (const auto& m : pending) { pos += gains[m.bucket] * m.delta; }
+    if (bounds.isValid()) { // Last pixel is at right() - 1 and bottom() - 1
+      pos.setX(qBound(bounds.left(), pos.x(), bounds.right() - 1));
+      pos.setY(qBound(bounds.top(), pos.y(), bounds.bottom() - 1));
+    }
+    return pos;
+  }
+
+  QPointF addMotion(int dx, int dy, qint64 timeUs, qint64 nowMs)
+  {
+    const QPointF delta(dx, dy);
+    const qint64 intervalUs = lastMotionUs ? timeUs - lastMotionUs : std::numeric_limits<qint64>::max();
+    lastMotionUs = timeUs;
+    pending.push_back(Motion{delta, prediction::speedBucket(delta, intervalUs), nowMs});
+
+    // Without cursor samples (e.g. the cursor is outside of all overlay windows) the prediction
+    // is all there is.
+    while (!pending.empty() && (pending.size() > prediction::maxPending
+                                || nowMs - pending.front().receivedMs > prediction::unconfirmedTimeout))
+    {
+      base += gains[pending.front().bucket] * pending.front().delta;
+      pending.pop_front();
+    }
+    return predicted();
+  }
+
+  QPointF reconcile(const QPointF& cursorPos, qint64 nowMs)
+  {
+    QPointF confirmed;
+    std::array<qreal, prediction::gainBuckets> weights{};
+    while (!pending.empty() && nowMs - pending.front().receivedMs >= confirmDelay)
+    {
+      const auto& m = pending.front();
+      confirmed += m.delta;
+      weights[m.bucket] += m.delta.manhattanLength();
+      pending.pop_front();
+    }
+
+    const qreal confirmedLength = std::hypot(confirmed.x(), confirmed.y());
+    if (hasCursor && confirmedLength >= prediction::minLearnDistance)
+    {
+      const auto bucket = std::distance(weights.cbegin(), std::max_element(weights.cbegin(), weights.cend()));
+      const QPointF moved = cursorPos - lastCursor;
+      const qreal gain = std::hypot(moved.x(), moved.y()) / confirmedLength;
+      gains[bucket] = qBound(prediction::minGain,
+                             gains[bucket] + prediction::learnRate * (gain - gains[bucket]),
+                             prediction::maxGain);
+    }
+
+    base = lastCursor = cursorPos;
+    hasCursor = true;
+    return predicted();
+  }
+
+  const qint64 confirmDelay;
+  QRectF bounds; ///< Virtual desktop, updated when screens change.
+  std::array<qreal, prediction::gainBuckets> gains;
+  std::deque<Motion> pending;
+  QPointF base;       ///< Last cursor sample plus motion that was never confirmed.
+  QPointF lastCursor;
+  bool hasCursor = false;
+  qint64 lastMotionUs = 0;
+};
+
+// -------------------------------------------------------------------------------------------------
+SpotController::State::Sample SpotController::State::latestSample() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_sample;
+}
+
+// -------------------------------------------------------------------------------------------------
+qreal SpotController::State::opacity(qint64 timeMs, bool* animating) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const qreal target = m_visible ? 1.0 : 0.0;
+  const qreal progress = qBound(0.0, qreal(timeMs - m_fadeStart) / fadeDuration, 1.0);
+  if (animating) { *animating = progress < 1.0; }
+  const qreal eased = progress * (2.0 - progress); // Easing.OutQuad
+  return m_fadeFrom + (target - m_fadeFrom) * eased;
+}
+
+// -------------------------------------------------------------------------------------------------
+qint64 SpotController::State::now()
+{
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// -------------------------------------------------------------------------------------------------
+SpotController::SpotController(QObject* parent)
+  : QObject(parent)
+  , m_state(std::make_shared<State>())
+{
+  // Keep the prediction bounds up to date, screens can be added and removed at any time.
+  if (!qGuiApp) { return; }
+
+  const auto watchScreen = [this](QScreen* screen) {
+    connect(screen, &QScreen::virtualGeometryChanged,
+            this, &SpotController::updatePredictionBounds);
+  };
+  for (const auto screen : QGuiApplication::screens()) { watchScreen(screen); }
+
+  connect(qGuiApp, &QGuiApplication::screenAdded, this, [this, watchScreen](QScreen* screen) {
+    watchScreen(screen);
+    updatePredictionBounds();
+  });
+  connect(qGuiApp, &QGuiApplication::screenRemoved, this, &SpotController::updatePredictionBounds);
+  connect(qGuiApp, &QGuiApplication::primaryScreenChanged, this,
+          &SpotController::updatePredictionBounds);
+}
+
+// -------------------------------------------------------------------------------------------------
+SpotController::~SpotController() = default;
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::attachWindow(QQuickWindow* window)
+{
+  if (!window) { return; }
+  m_windows.removeAll(QPointer<QQuickWindow>());
+  if (m_windows.contains(window)) { return; }
+
+  m_windows.push_back(window);
+  window->installEventFilter(this);
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::addSample(const QPointF& globalPos)
+{
+  publish(m_predictor ? m_predictor->reconcile(globalPos, State::now()) : globalPos);
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::addRelativeMotion(int dx, int dy, qint64 timeUs)
+{
+  // Prediction starts with the first cursor sample, i.e. when the overlay is shown.
+  if (!m_predictor || !m_predictor->hasCursor || !visible()) { return; }
+  publish(m_predictor->addMotion(dx, dy, timeUs, State::now()));
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::setPredictionEnabled(bool enabled)
+{
+  if (enabled == predictionEnabled()) { return; }
+
+  if (enabled)
+  {
+    // Motion is assumed to be included in cursor samples after one display frame.
+    const auto screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen ? std::max(screen->refreshRate(), 1.0) : 60.0;
+    m_predictor = std::make_unique<Predictor>(qRound64(1000.0 / refreshRate), desktopBounds());
+  }
+  else {
+    m_predictor.reset();
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::updatePredictionBounds()
+{
+  if (m_predictor) { m_predictor->bounds = desktopBounds(); }
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::publish(const QPointF& globalPos)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_state->m_mutex);
+    if (m_state->m_sample.sequence && m_state->m_sample.globalPos == globalPos) { return; }
+    m_state->m_sample.globalPos = globalPos;
+    ++m_state->m_sample.sequence;
+  }
+  requestFrames();
+}
+
+// -------------------------------------------------------------------------------------------------
+bool SpotController::visible() const
+{
+  std::lock_guard<std::mutex> lock(m_state->m_mutex);
+  return m_state->m_visible;
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::setVisible(bool visible)
+{
+  const qint64 now = State::now();
+  const qreal current = m_state->opacity(now);
+  {
+    std::lock_guard<std::mutex> lock(m_state->m_mutex);
+    if (m_state->m_visible == visible) { return; }
+    m_state->m_visible = visible;
+    m_state->m_fadeFrom = current;
+    m_state->m_fadeStart = now;
+  }
+
+  // The overlay may appear without any mouse move, start with the current cursor position.
+  if (visible) { addSample(QCursor::pos()); }
+  requestFrames();
+}
+
+// -------------------------------------------------------------------------------------------------
+bool SpotController::eventFilter(QObject* watched, QEvent* event)
+{
+  switch (event->type())
+  {
+  case QEvent::MouseMove:
+    addSample(globalPosition(static_cast<QMouseEvent*>(event)));
+    break;
+  case QEvent::Enter:
+    addSample(globalPosition(static_cast<QEnterEvent*>(event)));
+    break;
+  default:
+    break;
+  }
+  return QObject::eventFilter(watched, event);
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotController::requestFrames()
+{
+  for (const auto& window : m_windows) {
+    if (window && window->isVisible()) { window->update(); }
+  }
+}
@@ -0,0 +1,87 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QPointF>
+
+#include <memory>
+#include <mutex>
+
+class QQuickWindow;
+
+/// Cursor position and overlay fade state for the spotlight items.
+///
+/// Cursor samples are taken from the mouse events of the overlay windows on the GUI thread and
+/// read by the spotlight scene graph nodes on the render thread right before each frame. Only
+/// the latest sample is used per frame and no QML binding is evaluated in between.
+///
+/// Optionally the spot position is predicted from the relative motion events of the presenter
+/// device, which arrive at least one compositor frame before the cursor moves. The pointer
+/// acceleration is learned from the actual cursor movement and the prediction is reconciled
+/// with every real cursor sample.
+class SpotController : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// State shared with the render thread(s), all functions are thread safe.
+  class State
+  {
+  public:
+    struct Sample
+    {
+      QPointF globalPos;
+      quint64 sequence = 0; ///< Increases with every sample, 0 if there is no sample yet.
+    };
+
+    Sample latestSample() const;
+    /// Overlay opacity at the given time (see now()); animating is set to true while fading.
+    qreal opacity(qint64 timeMs, bool* animating = nullptr) const;
+    /// Monotonic time in milliseconds.
+    static qint64 now();
+
+  private:
+    friend class SpotController;
+    mutable std::mutex m_mutex;
+    Sample m_sample;
+    bool m_visible = false;
+    qreal m_fadeFrom = 0.0;
+    qint64 m_fadeStart = 0;
+  };
+
+  explicit SpotController(QObject* parent = nullptr);
+  ~SpotController() override;
+
+  /// Take cursor samples from the window's mouse events and request frames from it.
+  void attachWindow(QQuickWindow* window);
+
+  /// Add a cursor position sample in global coordinates.
+  void addSample(const QPointF& globalPos);
+  /// Add relative motion of a presenter device (device units) with its kernel time stamp.
+  void addRelativeMotion(int dx, int dy, qint64 timeUs);
+  std::shared_ptr<const State> state() const { return m_state; }
+
+  bool predictionEnabled() const { return m_predictor != nullptr; }
+  void setPredictionEnabled(bool enabled);
+
+  bool visible() const;
+  /// Fade the spotlight in or out; the fade is animated on the render thread.
+  void setVisible(bool visible);
+
+protected:
+  bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+  struct Predictor;
+
+  void publish(const QPointF& globalPos);
+  void updatePredictionBounds();
+  void requestFrames();
+
+  const std::shared_ptr<State> m_state;
+  std::unique_ptr<Predictor> m_predictor;
+  QList<QPointer<QQuickWindow>> m_windows;
+};
@@ -3,20 +3,19 @@
 
 #include "spotlight.h"
 
+#include "device-defs.h"
 #include "device-hidpp.h"
 #include "deviceinput.h"
+#include "inotify-helper.h"
 #include "logging.h"
 #include "settings.h"
 #include "virtualdevice.h"
 
 #include <QSocketNotifier>
 #include <QTimer>
-#include <QVarLengthArray>
 
 #include <cmath>
-#include <fcntl.h>
 #include <sys/inotify.h>
-#include <sys/ioctl.h>
 #include <unistd.h>
 
 DECLARE_LOGGING_CATEGORY(device)
@@ -29,6 +28,28 @@ namespace {
   // See details on workaround in onEventDataAvailable
   bool workaroundLogitechFirstMoveEvent = true;
 
+  namespace holdmove {
+    constexpr int FixedShift = 8;
+    constexpr int32_t FixedOne = 1 << FixedShift;
+    /// High-resolution units per step, same as REL_WHEEL_HI_RES units per wheel notch.
+    constexpr int32_t HiResPerStep = 120;
+    /// High-resolution units per unit of device movement speed in fixed point (1/16 step).
+    constexpr int32_t HiResPerUnit = HiResPerStep * FixedOne / 16;
+    /// Movement speeds below this value are treated as jitter.
+    constexpr int DeadZone = 2;
+    /// Maximum number of steps that can be pending, avoids overshooting after fast movements.
+    constexpr int32_t MaxPending = 3 * HiResPerStep * FixedOne;
+  } // end namespace holdmove
+
+  // -----------------------------------------------------------------------------------------------
+  qint64 eventTimeUs(const struct input_event& ev)
+  {
+  #ifdef input_event_sec
+    return qint64(ev.input_event_sec) * 1000000 + ev.input_event_usec;
+  #else
+    return qint64(ev.time.tv_sec) * 1000000 + ev.time.tv_usec;
+  #endif
+  }
 } // end anonymous namespace
 
 
@@ -70,6 +91,65 @@ private:
   KeyEventSequence m_moveKeyEvSeq;
 };
 
+// -------------------------------------------------------------------------------------------------
+// Integrates the hold-move notifications of a Logitech Spotlight device. Every notification is
+// accumulated in fixed point high-resolution units (1/120 of a step). At the output rate the
+// accumulated movement is taken out as high-resolution units and whole steps, the fractional
+// remainders are kept for the next output interval.
+struct HoldMoveAccumulator
+{
+  struct Steps {
+    int x = 0;      ///< whole steps
+    int y = 0;      ///< whole steps
+    int hiResX = 0; ///< 1/120 steps
+    int hiResY = 0; ///< 1/120 steps
+    bool empty() const { return hiResX == 0 && hiResY == 0; }
+  };
+
+  void add(int x, int y)
+  {
+    m_x = accumulate(m_x, x);
+    m_y = accumulate(m_y, y);
+  }
+
+  Steps takeSteps()
+  {
+    using holdmove::FixedOne;
+    using holdmove::HiResPerStep;
+    Steps steps;
+    steps.hiResX = m_x / FixedOne;
+    steps.hiResY = m_y / FixedOne;
+    m_x -= steps.hiResX * FixedOne;
+    m_y -= steps.hiResY * FixedOne;
+
+    m_stepX += steps.hiResX;
+    m_stepY += steps.hiResY;
+    steps.x = m_stepX / HiResPerStep;
+    steps.y = m_stepY / HiResPerStep;
+    m_stepX -= steps.x * HiResPerStep;
+    m_stepY -= steps.y * HiResPerStep;
+    return steps;
+  }
+
+  void reset() { m_x = m_y = m_stepX = m_stepY = 0; target.reset(); }
+
+  /// Input mapper of the device that sent the last move notification.
+  std::weak_ptr<InputMapper> target;
+
+private:
+  static int32_t accumulate(int32_t acc, int value)
+  {
+    using namespace holdmove;
+    if (std::abs(value) < DeadZone) { return acc; }
+    return qBound(-MaxPending, acc + value * HiResPerUnit, MaxPending);
+  }
+
+  int32_t m_x = 0;     ///< fixed point high-resolution units
+  int32_t m_y = 0;     ///< fixed point high-resolution units
+  int32_t m_stepX = 0; ///< high-resolution units not yet emitted as whole step
+  int32_t m_stepY = 0; ///< high-resolution units not yet emitted as whole step
+};
+
 // -------------------------------------------------------------------------------------------------
 Spotlight::Spotlight(QObject* parent, Options options, Settings* settings)
   : QObject(parent)
@@ -79,6 +159,7 @@ Spotlight::Spotlight(QObject* parent, Options options, Settings* settings)
   , m_holdMoveEventTimer(new QTimer(this))
   , m_settings(settings)
   , m_holdButtonStatus(std::make_unique<HoldButtonStatus>())
+  , m_holdMoveAccumulator(std::make_unique<HoldMoveAccumulator>())
 {
   constexpr int spotlightActiveTimoutMs = 600;
   m_activeTimer->setSingleShot(true);
@@ -111,8 +192,28 @@ Spotlight::Spotlight(QObject* parent, Options options, Settings* settings)
     connectDevices();
   });
 
-  m_holdMoveEventTimer->setSingleShot(true);
-  m_holdMoveEventTimer->setInterval(30);
+  m_holdMoveEventTimer->setInterval(m_settings->holdMoveInterval());
+  connect(m_holdMoveEventTimer, &QTimer::timeout, this, &Spotlight::onHoldMoveTimeout);
+  connect(m_settings, &Settings::holdMoveIntervalChanged, this, [this](int intervalMs) {
+    m_holdMoveEventTimer->setInterval(intervalMs);
+  });
+
+  // Settings file changed: update the input mapping of connected devices, unchanged input maps
+  // are not applied again and keep the state of the input mapper.
+  connect(m_settings, &Settings::deviceSettingsChanged, this, [this](const DeviceId& dId)
+  {
+    for (const auto& dc : m_deviceConnections)
+    {
+      if (dc.first.vendorId != dId.vendorId || dc.first.productId != dId.productId) { continue; }
+      const auto& im = dc.second->inputMapper();
+      if (!im) { continue; }
+      im->setKeyEventInterval(m_settings->deviceInputSeqInterval(dc.first));
+      // Writing the input map back would change the file right after the external tool wrote it.
+      m_applyingSettingsFile = true;
+      im->setConfiguration(m_settings->getDeviceInputMapConfig(dc.first));
+      m_applyingSettingsFile = false;
+    }
+  });
 
   // Try to find already attached device(s) and connect to it.
   connectDevices();
@@ -261,6 +362,7 @@ int Spotlight::connectDevices()
         im->setConfiguration(m_settings->getDeviceInputMapConfig(dev.id));
 
         connect(im, &InputMapper::configurationChanged, this, [this, id=dev.id, im]() {
+          if (m_applyingSettingsFile) { return; }
           m_settings->setDeviceInputMapConfig(id, im->configuration());
         });
 
@@ -289,14 +391,29 @@ int Spotlight::connectDevices()
           {
             if (!m_virtualMouseDevice) { return; }
 
-            const int param = (action->type() == Action::Type::ScrollHorizontal)
-              ? static_cast<ScrollHorizontalAction*>(action.get())->param
-              : static_cast<ScrollVerticalAction*>(action.get())->param;
+            const bool horizontal = (action->type() == Action::Type::ScrollHorizontal);
+            const int param = horizontal ? static_cast<ScrollHorizontalAction*>(action.get())->param
+                                         : static_cast<ScrollVerticalAction*>(action.get())->param;
+            const int hiResParam = horizontal
+              ? static_cast<ScrollHorizontalAction*>(action.get())->hiResParam
+              : static_cast<ScrollVerticalAction*>(action.get())->hiResParam;
+
+            // High-resolution wheel events in 1/120 of a notch, accompanied by legacy wheel
+            // events whenever a whole notch is completed.
+            std::vector<input_event> scrollInputEvents;
+            scrollInputEvents.reserve(3);
+            if (hiResParam) {
+              const uint16_t hiResCode = horizontal ? REL_HWHEEL_HI_RES : REL_WHEEL_HI_RES;
+              scrollInputEvents.push_back({{}, EV_REL, hiResCode, hiResParam});
+            }
+            if (param) {
+              const uint16_t wheelCode = horizontal ? REL_HWHEEL : REL_WHEEL;
+              scrollInputEvents.push_back({{}, EV_REL, wheelCode, param});
+            }
 
-            if (param)
+            if (!scrollInputEvents.empty())
             {
-              const uint16_t wheelCode = (action->type() == Action::Type::ScrollHorizontal) ? REL_HWHEEL : REL_WHEEL;
-              const std::vector<input_event> scrollInputEvents = {{{}, EV_REL, wheelCode, param}, {{}, EV_SYN, SYN_REPORT, 0},};
+              scrollInputEvents.push_back({{}, EV_SYN, SYN_REPORT, 0});
               m_virtualMouseDevice->emitEvents(scrollInputEvents);
             }
           }
@@ -427,6 +544,15 @@ void Spotlight::onEventDataAvailable(int fd, SubEventConnection& connection)
         }
 
         m_activeTimer->start();
+        int dx = 0, dy = 0;
+        for (size_t i = 0; i < buf.pos(); ++i)
+        {
+          if (buf[i].type != EV_REL) { continue; }
+          if (buf[i].code == REL_X) { dx += buf[i].value; }
+          else if (buf[i].code == REL_Y) { dy += buf[i].value; }
+        }
+        if (dx || dy) { emit relativeMotion(dx, dy, eventTimeUs(ev)); }
+
         if (m_virtualMouseDevice) {
           // forward events to virtual mouse device
           m_virtualMouseDevice->emitEvents(buf.data(), buf.pos());
@@ -488,18 +614,17 @@ void Spotlight::registerForNotifications(SubHidppConnection* connection)
       }
 
       m_holdButtonStatus->setButtonsPressed(isNextPressed, isBackPressed);
+
+      if (!isNextPressed && !isBackPressed) {
+        // Discard any motion that was not turned into steps yet.
+        m_holdMoveEventTimer->stop();
+        m_holdMoveAccumulator->reset();
+      }
     }), 0 /* function 0 */);
 
     connection->registerNotificationCallback(this, rcIndex,
     makeSafeCallback([this, connection](Message&& msg)
     {
-      // Block some of the move events
-      // TODO This works quiet okay in combination with adjusting x and y values,
-      // but needs to be a more solid option to accumulate the mass of move events
-      // and consolidate them to a number of meaningful action special key events.
-      if (m_holdMoveEventTimer->isActive()) { return; }
-      m_holdMoveEventTimer->start();
-
       // byte 4 : -1 for left movement, 0 for right movement
       // byte 5 : horizontal movement speed -128 to 127
       // byte 6 : -1 for up movement, 0 for down movement
@@ -507,39 +632,43 @@ void Spotlight::registerForNotifications(SubHidppConnection* connection)
 
       static const auto intcast = [](uint8_t v) -> int{ return static_cast<int8_t>(v); };
 
-      const int x = intcast(msg[5]);
-      const int y = intcast(msg[7]);
-
-      static const auto getReducedParam = [](int param) -> int {
-        constexpr int divider = 5;
-        constexpr int minimum = 5;
-        constexpr int maximum = 10;
-        if (std::abs(param) < minimum) { return 0; }
-        const auto sign = (param == 0) ? 0 : ((param > 0) ? 1 : -1);
-        return std::floor(1.0 * ((abs(param) > maximum)? sign * maximum : param) / divider);
-      };
+      // Accumulate every move notification, steps are emitted by onHoldMoveTimeout
+      // at the configured output rate.
+      m_holdMoveAccumulator->add(intcast(msg[5]), intcast(msg[7]));
+      m_holdMoveAccumulator->target = connection->inputMapper();
+      if (!m_holdMoveEventTimer->isActive()) { m_holdMoveEventTimer->start(); }
+    }), 1 /* function 1 */);
+  }
+}
 
-      const int adjustedX = getReducedParam(x);
-      const int adjustedY = getReducedParam(y);
+// -------------------------------------------------------------------------------------------------
+void Spotlight::onHoldMoveTimeout()
+{
+  const auto steps = m_holdMoveAccumulator->takeSteps();
+  const auto inputMapper = m_holdMoveAccumulator->target.lock();
 
-      if (adjustedX == 0 && adjustedY == 0) { return; }
+  if (steps.empty() || !inputMapper) {
+    // No movement during the last output interval, stop until the next notification.
+    m_holdMoveEventTimer->stop();
+    return;
+  }
 
-      static const auto scrollHAction = GlobalActions::scrollHorizontal();
-      scrollHAction->param = -adjustedX;
+  static const auto scrollHAction = GlobalActions::scrollHorizontal();
+  scrollHAction->param = -steps.x;
+  scrollHAction->hiResParam = -steps.hiResX;
 
-      static const auto scrollVAction = GlobalActions::scrollVertical();
-      scrollVAction->param = adjustedY;
+  static const auto scrollVAction = GlobalActions::scrollVertical();
+  scrollVAction->param = steps.y;
+  scrollVAction->hiResParam = steps.hiResY;
 
-      static const auto volumeControlAction = GlobalActions::volumeControl();
-      volumeControlAction->param = -adjustedY;
+  static const auto volumeControlAction = GlobalActions::volumeControl();
+  volumeControlAction->param = -steps.y;
 
-      if (!connection->inputMapper()->recordingMode())
-      {
-          for (const auto& key_event : m_holdButtonStatus->moveKeyEventSeq()) {
-            connection->inputMapper()->addEvents(key_event);
-          }
-      }
-    }), 1 /* function 1 */);
+  if (!inputMapper->recordingMode())
+  {
+    for (const auto& key_event : m_holdButtonStatus->moveKeyEventSeq()) {
+      inputMapper->addEvents(key_event);
+    }
   }
 }
 
@@ -562,53 +691,19 @@ bool Spotlight::addInputEventHandler(std::shared_ptr<SubEventConnection> connect
 // -------------------------------------------------------------------------------------------------
 bool Spotlight::setupDevEventInotify()
 {
-  int fd = -1;
-#if defined(IN_CLOEXEC)
-  fd = inotify_init1(IN_CLOEXEC);
-#endif
-  if (fd == -1)
+  const auto notifier = inotify::watch("/dev/input", IN_CREATE | IN_DELETE, this,
+  [this](uint32_t mask, const QString& name)
   {
-    fd = inotify_init();
-    if (fd == -1) {
-      logError(device) << tr("inotify_init() failed. Detection of new attached devices will not work.");
-      return false;
-    }
-  }
-  fcntl(fd, F_SETFD, FD_CLOEXEC);
-  const int wd = inotify_add_watch(fd, "/dev/input", IN_CREATE | IN_DELETE);
-
-  if (wd < 0) {
-    logError(device) << tr("inotify_add_watch for /dev/input returned with failure.");
-    return false;
-  }
-
-  const auto notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
-  connect(notifier, &QSocketNotifier::activated, this, [this](int fd)
-  {
-    int bytesAvaibable = 0;
-    if (ioctl(fd, FIONREAD, &bytesAvaibable) < 0 || bytesAvaibable <= 0) {
-      return; // Error or no bytes available
-    }
-    QVarLengthArray<char, 2048> buffer(bytesAvaibable);
-    const auto bytesRead = read(fd, buffer.data(), static_cast<size_t>(bytesAvaibable));
-    const char* at = buffer.data();
-    const char* const end = at + bytesRead;
-    while (at < end)
+    if ((mask & IN_CREATE) && name.startsWith("event"))
     {
-      const auto event = reinterpret_cast<const inotify_event*>(at);
-
-      if ((event->mask & (IN_CREATE)) && QString(event->name).startsWith("event"))
-      {
-        // Trigger new device scan and connect if a new event device was created.
-        m_connectionTimer->start();
-      }
-
-      at += sizeof(inotify_event) + event->len;
+      // Trigger new device scan and connect if a new event device was created.
+      m_connectionTimer->start();
     }
   });
 
-  connect(notifier, &QSocketNotifier::destroyed, [notifier]() {
-    ::close(static_cast<int>(notifier->socket()));
-  });
+  if (!notifier) {
+    logError(device) << tr("inotify watch for /dev/input failed. Detection of new attached devices will not work.");
+    return false;
+  }
   return true;
 }
@@ -19,6 +19,7 @@ class SubEventConnection;
 class SubHidppConnection;
 
 struct HoldButtonStatus;
+struct HoldMoveAccumulator;
 
 /// Class handling spotlight device connections and indicating if a device is sending
 /// sending mouse move events.
@@ -55,6 +56,8 @@ signals:
   void subDeviceDisconnected(const DeviceId& id, const QString& name, const QString& path);
   void anySpotlightDeviceConnectedChanged(bool connected);
   void spotActiveChanged(bool isActive);
+  /// Relative motion of a device (REL_X/REL_Y of one event frame) with the kernel time stamp.
+  void relativeMotion(int dx, int dy, qint64 timeUs);
 
 private:
   enum class ConnectionResult { CouldNotOpen, NotASpotlightDevice, Connected };
@@ -67,6 +70,7 @@ private:
   int connectDevices();
   void removeDeviceConnection(const QString& devicePath);
   void onEventDataAvailable(int fd, SubEventConnection& connection);
+  void onHoldMoveTimeout();
 
   const Options m_options;
   std::map<DeviceId, std::shared_ptr<DeviceConnection>> m_deviceConnections;
@@ -76,8 +80,10 @@ private:
   QTimer* m_connectionTimer = nullptr;
   QTimer* m_holdMoveEventTimer = nullptr;
   bool m_spotActive = false;
+  bool m_applyingSettingsFile = false; ///< Input maps from the settings file are not saved again.
   std::shared_ptr<VirtualDevice> m_virtualMouseDevice;
   std::shared_ptr<VirtualDevice> m_virtualKeyDevice;
   Settings* m_settings = nullptr;
   std::unique_ptr<HoldButtonStatus> m_holdButtonStatus;
+  std::unique_ptr<HoldMoveAccumulator> m_holdMoveAccumulator;
 };
@@ -0,0 +1,1207 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+
+#include "spotlightitem.h"
+
+#include "spotcontroller.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGNode>
+#include <QSGTextureMaterial>
+#include <QSGVertexColorMaterial>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+#include <QSGRectangleNode>
+#include <QSGRenderNode>
+#include <QSGRendererInterface>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+// -------------------------------------------------------------------------------------------------
+/// All outlines needed to draw the spot, relative to the spot center. They only depend on the
+/// shape, the spot size and the border size and are shared by all items with the same values.
+struct SpotOutlines
+{
+  QVector<QPointF> outline;      // shape outline with the diagonal points
+  QVector<QPointF> fringe;       // outline moved outwards by the anti-aliasing fringe
+  QVector<QPointF> squareFringe; // fringe projected onto the surrounding square
+  QVector<QPointF> inner;        // inner border outline
+  QVector<QPointF> innerFringe;  // inner border outline moved inwards by the fringe
+};
+
+// -------------------------------------------------------------------------------------------------
+struct DotOutlines
+{
+  qreal radius = 0;
+  QVector<QPointF> outline;
+  QVector<QPointF> fringe;
+};
+
+namespace {
+  const bool registered = [](){
+    SpotlightItem::qmlRegister();
+    return true;
+  }();
+
+  // Width of the anti-aliasing fringe along the outlines in pixels.
+  constexpr qreal fringe = 1.0;
+
+  // -----------------------------------------------------------------------------------------------
+  /// Everything needed to render one frame of the spotlight, independent of the item.
+  struct SpotFrame
+  {
+    QRectF bounds;
+    QPointF center;
+    qreal halfSize = 0;
+    std::shared_ptr<const SpotOutlines> outlines;
+    bool shade = false;
+    bool border = false;
+    bool dot = false;
+    bool zoom = false;
+    QColor shadeColor;         // colors include the opacity
+    QColor borderColor;
+    QColor dotColor;
+    qreal dotRadius = 0;
+    std::shared_ptr<const DotOutlines> dotOutlines;
+    quint64 styleGeneration = 0; // changes with everything except position and zoom
+    qreal zoomFactor = 1.0;
+    QTransform itemToScene;    // maps item coordinates to window coordinates of the zoom source
+    QSizeF windowSize;
+    bool smooth = false;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  // Maps item coordinates inside the spot to the window coordinates of the desktop that should be
+  // visible at that point, i.e. the desktop around the spot center magnified by the zoom factor.
+  QTransform zoomTransform(const SpotFrame& f)
+  {
+    const QPointF& c = f.center;
+    const qreal s = 1.0 / f.zoomFactor;
+    return QTransform::fromTranslate(-c.x(), -c.y()) * QTransform::fromScale(s, s)
+           * QTransform::fromTranslate(c.x(), c.y()) * f.itemToScene;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QPointF radial(const QPointF& p, qreal distance)
+  {
+    const qreal length = std::hypot(p.x(), p.y());
+    if (length <= 0) { return p; }
+    return p * std::max(0.0, 1.0 + distance / length);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  // Project p from the center onto the square with the given half size.
+  QPointF projectToSquare(const QPointF& p, qreal halfSize)
+  {
+    const qreal m = std::max(std::abs(p.x()), std::abs(p.y()));
+    if (m <= 0) { return p; }
+    return p * (halfSize / m);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  // Add the points where the outline crosses the diagonals, so that every segment of the
+  // result projects onto a single side of the surrounding square.
+  QVector<QPointF> withDiagonalPoints(const QVector<QPointF>& outline)
+  {
+    QVector<QPointF> result;
+    result.reserve(outline.size() + 8);
+    const int n = outline.size();
+    for (int i = 0; i < n; ++i)
+    {
+      const QPointF& a = outline[i];
+      const QPointF& b = outline[(i + 1) % n];
+      result.push_back(a);
+
+      std::array<qreal, 2> crossings{};
+      int count = 0;
+      for (const qreal sign : {1.0, -1.0})
+      {
+        const qreal fa = a.y() - sign * a.x();
+        const qreal fb = b.y() - sign * b.x();
+        if ((fa < 0 && fb > 0) || (fa > 0 && fb < 0)) {
+          crossings[count++] = fa / (fa - fb);
+        }
+      }
+      std::sort(crossings.begin(), crossings.begin() + count);
+      for (int c = 0; c < count; ++c) {
+        result.push_back(a + crossings[c] * (b - a));
+      }
+    }
+    return result;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  template<typename F>
+  QVector<QPointF> transformed(const QVector<QPointF>& points, F&& f)
+  {
+    QVector<QPointF> result;
+    result.reserve(points.size());
+    for (const auto& p : points) { result.push_back(f(p)); }
+    return result;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Keeps the most recently used values, shared between all users with the same key.
+  template<typename Key, typename Value, size_t Capacity = 8>
+  class SharedCache
+  {
+  public:
+    template<typename Create>
+    std::shared_ptr<const Value> get(const Key& key, Create&& create)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      const auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                                   [&key](const Entry& e) { return e.first == key; });
+      if (it != m_entries.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it);
+      }
+      else
+      {
+        m_entries.emplace_front(key, std::make_shared<const Value>(create()));
+        if (m_entries.size() > Capacity) { m_entries.pop_back(); }
+      }
+      return m_entries.front().second;
+    }
+
+  private:
+    using Entry = std::pair<Key, std::shared_ptr<const Value>>;
+    std::mutex m_mutex;
+    std::list<Entry> m_entries; // most recently used first
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  std::shared_ptr<const SpotOutlines> spotOutlines(const SpotShapes::Parameters& params, qreal size,
+                                                   qreal innerScale)
+  {
+    static SharedCache<std::tuple<SpotShapes::Parameters, qreal, qreal>, SpotOutlines> cache;
+    return cache.get(std::make_tuple(params, size, innerScale), [&]()
+    {
+      SpotOutlines o;
+      o.outline = withDiagonalPoints(SpotShapes::outline(params, size));
+      o.fringe = transformed(o.outline, [](const QPointF& p){ return radial(p, fringe); });
+      const qreal h = size / 2 + fringe;
+      o.squareFringe = transformed(o.fringe, [h](const QPointF& p){ return projectToSquare(p, h); });
+      o.inner = transformed(o.outline, [innerScale](const QPointF& p){ return p * innerScale; });
+      o.innerFringe = transformed(o.inner, [](const QPointF& p){ return radial(p, -fringe); });
+      return o;
+    });
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  std::shared_ptr<const DotOutlines> dotOutlines(qreal radius)
+  {
+    static SharedCache<qreal, DotOutlines, 4> cache;
+    return cache.get(radius, [radius]()
+    {
+      DotOutlines o;
+      o.radius = radius;
+      o.outline = SpotShapes::outline(SpotShapes::Parameters(), 2 * radius);
+      o.fringe = transformed(o.outline, [](const QPointF& p){ return radial(p, fringe); });
+      return o;
+    });
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QColor withOpacity(QColor color, qreal opacity)
+  {
+    color.setAlphaF(color.alphaF() * qBound(0.0, opacity, 1.0));
+    return color;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Collects colored triangles for QSGVertexColorMaterial (premultiplied colors).
+  class TriangleWriter
+  {
+  public:
+    using Vertex = QSGGeometry::ColoredPoint2D;
+
+    explicit TriangleWriter(std::vector<Vertex>& vertices) : m_vertices(vertices) {}
+
+    void triangle(const QPointF& a, const QColor& ca, const QPointF& b, const QColor& cb,
+                  const QPointF& c, const QColor& cc)
+    {
+      add(a, ca); add(b, cb); add(c, cc);
+    }
+
+    void quad(const QPointF& a0, const QPointF& a1, const QColor& ca,
+              const QPointF& b0, const QPointF& b1, const QColor& cb)
+    {
+      triangle(a0, ca, b0, cb, b1, cb);
+      triangle(a0, ca, b1, cb, a1, ca);
+    }
+
+    void rect(const QRectF& r, const QColor& color)
+    {
+      if (r.width() <= 0 || r.height() <= 0) { return; }
+      quad(r.topLeft(), r.topRight(), color, r.bottomLeft(), r.bottomRight(), color);
+    }
+
+    // Ring between two outlines with the same number of points.
+    void ring(const QPointF& center, const QVector<QPointF>& inner, const QColor& innerColor,
+              const QVector<QPointF>& outer, const QColor& outerColor)
+    {
+      const int n = inner.size();
+      for (int i = 0; i < n; ++i) {
+        const int j = (i + 1) % n;
+        quad(center + inner[i], center + inner[j], innerColor,
+             center + outer[i], center + outer[j], outerColor);
+      }
+    }
+
+    void fan(const QPointF& center, const QVector<QPointF>& outline, const QColor& color)
+    {
+      const int n = outline.size();
+      for (int i = 0; i < n; ++i) {
+        triangle(center, color, center + outline[i], color, center + outline[(i + 1) % n], color);
+      }
+    }
+
+  private:
+    void add(const QPointF& p, const QColor& c)
+    {
+      const qreal a = c.alphaF();
+      m_vertices.emplace_back();
+      m_vertices.back().set(static_cast<float>(p.x()), static_cast<float>(p.y()),
+                            static_cast<uchar>(c.red() * a), static_cast<uchar>(c.green() * a),
+                            static_cast<uchar>(c.blue() * a), static_cast<uchar>(c.alpha()));
+    }
+
+    std::vector<Vertex>& m_vertices;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  QPolygonF toPolygon(const QPointF& center, const QVector<QPointF>& outline)
+  {
+    QPolygonF polygon;
+    polygon.reserve(outline.size());
+    for (const auto& p : outline) { polygon.push_back(center + p); }
+    return polygon;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  void buildSpotTriangles(const SpotFrame& f, std::vector<QSGGeometry::ColoredPoint2D>& vertices)
+  {
+    // Only translated by the center, all outlines are computed when the shape changes.
+    TriangleWriter writer(vertices);
+    const QColor transparent(0, 0, 0, 0);
+    const SpotOutlines& o = *f.outlines;
+
+    if (f.shade)
+    {
+      // Anti-aliased spot edge, ring to the surrounding square and the rest of the item.
+      const qreal h = f.halfSize + fringe;
+      writer.ring(f.center, o.outline, transparent, o.fringe, f.shadeColor);
+      writer.ring(f.center, o.fringe, f.shadeColor, o.squareFringe, f.shadeColor);
+
+      const QRectF square(f.center - QPointF(h, h), f.center + QPointF(h, h));
+      const QRectF& b = f.bounds;
+      const qreal top = std::max(square.top(), b.top());
+      const qreal bottom = std::min(square.bottom(), b.bottom());
+      writer.rect(QRectF(QPointF(b.left(), b.top()), QPointF(b.right(), square.top())), f.shadeColor);
+      writer.rect(QRectF(QPointF(b.left(), square.bottom()), QPointF(b.right(), b.bottom())), f.shadeColor);
+      writer.rect(QRectF(QPointF(b.left(), top), QPointF(square.left(), bottom)), f.shadeColor);
+      writer.rect(QRectF(QPointF(square.right(), top), QPointF(b.right(), bottom)), f.shadeColor);
+    }
+
+    if (f.border)
+    {
+      writer.ring(f.center, o.innerFringe, transparent, o.inner, f.borderColor);
+      writer.ring(f.center, o.inner, f.borderColor, o.outline, f.borderColor);
+      writer.ring(f.center, o.outline, f.borderColor, o.fringe, transparent);
+    }
+
+    if (f.dot && f.dotOutlines)
+    {
+      writer.fan(f.center, f.dotOutlines->outline, f.dotColor);
+      writer.ring(f.center, f.dotOutlines->outline, f.dotColor, f.dotOutlines->fringe, transparent);
+    }
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  QSGGeometry::DrawingMode trianglesMode()
+  {
+  #if QT_VERSION >= 0x050800
+    return QSGGeometry::DrawTriangles;
+  #else
+    return GL_TRIANGLES;
+  #endif
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Copy image into target at the given pixel position, clipped to target. Only detaches target
+  /// if it is shared, the cost is otherwise proportional to the size of image.
+  void copyPixels(QImage& target, const QPoint& position, const QImage& image)
+  {
+    const QRect r = QRect(position, image.size()).intersected(target.rect());
+    if (r.isEmpty() || target.depth() < 8) { return; }
+
+    const QImage source = image.format() == target.format() ? image
+                                                             : image.convertToFormat(target.format());
+    const int bytesPerPixel = target.depth() / 8;
+    const auto bytes = static_cast<size_t>(r.width() * bytesPerPixel);
+    for (int y = r.top(); y <= r.bottom(); ++y)
+    {
+      std::memcpy(target.scanLine(y) + r.x() * bytesPerPixel,
+                  source.constScanLine(y - position.y()) + (r.x() - position.x()) * bytesPerPixel,
+                  bytes);
+    }
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Base of the backend specific nodes that draw a SpotFrame.
+  class SpotlightContentNode : public QSGNode
+  {
+  public:
+    virtual void update(const SpotFrame& frame) = 0;
+    /// The zoom image is shared with the item and only modified during the synchronization
+    /// with the GUI thread, after which zoomImageChanged() is called with the modified area.
+    virtual void setZoomImage(std::shared_ptr<const QImage> image) = 0;
+    virtual void zoomImageChanged(const QRect& rect) = 0;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  /// The zoom source as tiled textures. A tile is uploaded when the spot shows a part of it for
+  /// the first time and then again only if its pixels changed (live zoom).
+  class ZoomTiles
+  {
+  public:
+    static constexpr int TileSize = 256;
+
+    ZoomTiles() = default;
+    ZoomTiles(const ZoomTiles&) = delete;
+    ZoomTiles& operator=(const ZoomTiles&) = delete;
+    ~ZoomTiles() { clear(); }
+
+    void setImage(std::shared_ptr<const QImage> image)
+    {
+      clear();
+      m_image = (image && !image->isNull()) ? std::move(image) : nullptr;
+      if (!m_image) { return; }
+
+      m_columns = (m_image->width() + TileSize - 1) / TileSize;
+      m_rows = (m_image->height() + TileSize - 1) / TileSize;
+      m_tiles.resize(static_cast<size_t>(m_columns * m_rows));
+    }
+
+    void invalidate(const QRect& rect)
+    {
+      if (!m_image) { return; }
+      // Tile textures contain a one pixel border of their neighbours, see textureRect().
+      const QRect r = rect.adjusted(-1, -1, 1, 1).intersected(m_image->rect());
+      if (r.isEmpty()) { return; }
+      for (int row = r.top() / TileSize; row <= r.bottom() / TileSize; ++row) {
+        for (int column = r.left() / TileSize; column <= r.right() / TileSize; ++column) {
+          m_tiles[static_cast<size_t>(row * m_columns + column)].dirty = true;
+        }
+      }
+    }
+
+    bool isNull() const { return !m_image; }
+    QSize imageSize() const { return m_image ? m_image->size() : QSize(); }
+    int columns() const { return m_columns; }
+    int rows() const { return m_rows; }
+
+    QRect tileRect(int column, int row) const
+    {
+      return QRect(column * TileSize, row * TileSize, TileSize, TileSize).intersected(m_image->rect());
+    }
+
+    // With linear filtering, pixels at the tile edges are interpolated with their neighbours.
+    QRect textureRect(int column, int row) const
+    {
+      return tileRect(column, row).adjusted(-1, -1, 1, 1).intersected(m_image->rect());
+    }
+
+    QSGTexture* texture(QQuickWindow* window, int column, int row)
+    {
+      auto& tile = m_tiles[static_cast<size_t>(row * m_columns + column)];
+      if (!tile.texture || tile.dirty)
+      {
+        delete tile.texture;
+        tile.texture = window->createTextureFromImage(m_image->copy(textureRect(column, row)));
+        tile.dirty = false;
+      }
+      return tile.texture;
+    }
+
+  private:
+    void clear()
+    {
+      for (auto& tile : m_tiles) { delete tile.texture; }
+      m_tiles.clear();
+      m_columns = m_rows = 0;
+    }
+
+    struct Tile
+    {
+      QSGTexture* texture = nullptr;
+      bool dirty = false;
+    };
+
+    std::shared_ptr<const QImage> m_image;
+    std::vector<Tile> m_tiles;
+    int m_columns = 0;
+    int m_rows = 0;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  struct ZoomVertex
+  {
+    QPointF position; ///< Item coordinates
+    QPointF source;   ///< Pixel coordinates in the zoom source
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  // One step of the Sutherland-Hodgman algorithm: clip the convex polygon against one edge.
+  template<typename Inside, typename Intersection>
+  void clipPolygon(const std::vector<ZoomVertex>& in, std::vector<ZoomVertex>& out,
+                   Inside inside, Intersection intersection)
+  {
+    out.clear();
+    const size_t n = in.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+      const ZoomVertex& a = in[i];
+      const ZoomVertex& b = in[(i + 1) % n];
+      const bool aInside = inside(a.source);
+      if (aInside) { out.push_back(a); }
+      if (aInside != inside(b.source))
+      {
+        const qreal t = intersection(a.source, b.source);
+        out.push_back(ZoomVertex{ a.position + (b.position - a.position) * t,
+                                  a.source + (b.source - a.source) * t });
+      }
+    }
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  // Clip the triangle a, b, c to the source rect and append the result as triangles.
+  void clipTriangle(const ZoomVertex& a, const ZoomVertex& b, const ZoomVertex& c, const QRectF& rect,
+                    std::vector<ZoomVertex>& polygon, std::vector<ZoomVertex>& scratch,
+                    std::vector<ZoomVertex>& triangles)
+  {
+    const qreal left = std::min({a.source.x(), b.source.x(), c.source.x()});
+    const qreal right = std::max({a.source.x(), b.source.x(), c.source.x()});
+    const qreal top = std::min({a.source.y(), b.source.y(), c.source.y()});
+    const qreal bottom = std::max({a.source.y(), b.source.y(), c.source.y()});
+    if (right <= rect.left() || left >= rect.right() || bottom <= rect.top() || top >= rect.bottom()) {
+      return;
+    }
+    if (left >= rect.left() && right <= rect.right() && top >= rect.top() && bottom <= rect.bottom()) {
+      triangles.insert(triangles.end(), { a, b, c });
+      return;
+    }
+
+    polygon.assign({ a, b, c });
+    clipPolygon(polygon, scratch, [&rect](const QPointF& p) { return p.x() >= rect.left(); },
+                [&rect](const QPointF& p0, const QPointF& p1) { return (rect.left() - p0.x()) / (p1.x() - p0.x()); });
+    clipPolygon(scratch, polygon, [&rect](const QPointF& p) { return p.x() <= rect.right(); },
+                [&rect](const QPointF& p0, const QPointF& p1) { return (rect.right() - p0.x()) / (p1.x() - p0.x()); });
+    clipPolygon(polygon, scratch, [&rect](const QPointF& p) { return p.y() >= rect.top(); },
+                [&rect](const QPointF& p0, const QPointF& p1) { return (rect.top() - p0.y()) / (p1.y() - p0.y()); });
+    clipPolygon(scratch, polygon, [&rect](const QPointF& p) { return p.y() <= rect.bottom(); },
+                [&rect](const QPointF& p0, const QPointF& p1) { return (rect.bottom() - p0.y()) / (p1.y() - p0.y()); });
+
+    for (size_t i = 2; i < polygon.size(); ++i) {
+      triangles.insert(triangles.end(), { polygon[0], polygon[i - 1], polygon[i] });
+    }
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Scene graph node for hardware accelerated backends: the zoom (if any) as textured geometry
+  /// per zoom source tile and everything else as a single vertex colored geometry.
+  ///
+  /// Moving the spot only changes vertex data; tile textures are uploaded when the spot reaches
+  /// them for the first time and after their pixels changed.
+  class SpotlightNode : public SpotlightContentNode
+  {
+  public:
+    explicit SpotlightNode(QQuickWindow* window)
+      : m_window(window)
+    {
+      m_spotNode = new QSGGeometryNode();
+      auto geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+      geometry->setDrawingMode(trianglesMode());
+      m_spotNode->setGeometry(geometry);
+      m_spotNode->setFlag(QSGNode::OwnsGeometry);
+      m_spotNode->setMaterial(new QSGVertexColorMaterial());
+      m_spotNode->setFlag(QSGNode::OwnsMaterial);
+      appendChildNode(m_spotNode);
+    }
+
+    void update(const SpotFrame& frame) override
+    {
+      updateSpot(frame);
+      updateZoom(frame);
+    }
+
+    void setZoomImage(std::shared_ptr<const QImage> image) override
+    {
+      // Tile nodes still reference the old textures, they are updated before the next frame.
+      m_zoomTiles.setImage(std::move(image));
+    }
+
+    void zoomImageChanged(const QRect& rect) override { m_zoomTiles.invalidate(rect); }
+
+  private:
+    void updateSpot(const SpotFrame& frame)
+    {
+      m_vertices.clear();
+      buildSpotTriangles(frame, m_vertices);
+
+      const auto geometry = m_spotNode->geometry();
+      if (geometry->vertexCount() != static_cast<int>(m_vertices.size())) {
+        geometry->allocate(static_cast<int>(m_vertices.size()));
+      }
+      std::copy(m_vertices.cbegin(), m_vertices.cend(), geometry->vertexDataAsColoredPoint2D());
+      m_spotNode->markDirty(QSGNode::DirtyGeometry);
+    }
+
+    void updateZoom(const SpotFrame& f)
+    {
+      if (!f.zoom || m_zoomTiles.isNull() || f.windowSize.isEmpty())
+      {
+        removeZoomNodes(0);
+        return;
+      }
+
+      // The spot as triangle fan around the center, with the zoom source pixel of each vertex.
+      const QSize imageSize = m_zoomTiles.imageSize();
+      const QTransform toSource = zoomTransform(f)
+        * QTransform::fromScale(imageSize.width() / f.windowSize.width(),
+                                imageSize.height() / f.windowSize.height());
+      const auto& outline = f.border ? f.outlines->inner : f.outlines->outline;
+      const int n = outline.size();
+      m_zoomFan.clear();
+      m_zoomFan.reserve(static_cast<size_t>(n + 1));
+      m_zoomFan.push_back(ZoomVertex{ f.center, toSource.map(f.center) });
+      QRectF sourceBounds(m_zoomFan.front().source, QSizeF(0, 0));
+      for (const auto& p : outline)
+      {
+        const QPointF position = f.center + p;
+        m_zoomFan.push_back(ZoomVertex{ position, toSource.map(position) });
+        sourceBounds |= QRectF(m_zoomFan.back().source, QSizeF(0, 0));
+      }
+
+      using Tiles = ZoomTiles;
+      const int firstColumn = std::max(0, static_cast<int>(std::floor(sourceBounds.left() / Tiles::TileSize)));
+      const int lastColumn = std::min(m_zoomTiles.columns() - 1,
+                                      static_cast<int>(std::floor(sourceBounds.right() / Tiles::TileSize)));
+      const int firstRow = std::max(0, static_cast<int>(std::floor(sourceBounds.top() / Tiles::TileSize)));
+      const int lastRow = std::min(m_zoomTiles.rows() - 1,
+                                   static_cast<int>(std::floor(sourceBounds.bottom() / Tiles::TileSize)));
+
+      int nodeCount = 0;
+      for (int row = firstRow; row <= lastRow; ++row)
+      {
+        for (int column = firstColumn; column <= lastColumn; ++column)
+        {
+          const QRectF tileRect = m_zoomTiles.tileRect(column, row);
+          m_zoomTriangles.clear();
+          for (int i = 0; i < n; ++i)
+          {
+            clipTriangle(m_zoomFan[0], m_zoomFan[static_cast<size_t>(i + 1)],
+                         m_zoomFan[static_cast<size_t>((i + 1) % n + 1)], tileRect,
+                         m_clipPolygon, m_clipScratch, m_zoomTriangles);
+          }
+          if (m_zoomTriangles.empty()) { continue; }
+
+          const auto node = zoomNode(nodeCount++);
+          const auto geometry = node->geometry();
+          if (geometry->vertexCount() != static_cast<int>(m_zoomTriangles.size())) {
+            geometry->allocate(static_cast<int>(m_zoomTriangles.size()));
+          }
+
+          const QRectF textureRect = m_zoomTiles.textureRect(column, row);
+          auto* v = geometry->vertexDataAsTexturedPoint2D();
+          for (const auto& t : m_zoomTriangles)
+          {
+            (v++)->set(float(t.position.x()), float(t.position.y()),
+                       float((t.source.x() - textureRect.x()) / textureRect.width()),
+                       float((t.source.y() - textureRect.y()) / textureRect.height()));
+          }
+
+          auto material = static_cast<QSGTextureMaterial*>(node->material());
+          material->setTexture(m_zoomTiles.texture(m_window, column, row));
+          material->setFiltering(f.smooth ? QSGTexture::Linear : QSGTexture::Nearest);
+          node->markDirty(QSGNode::DirtyGeometry | QSGNode::DirtyMaterial);
+        }
+      }
+      removeZoomNodes(nodeCount);
+    }
+
+    QSGGeometryNode* zoomNode(int index)
+    {
+      if (index < static_cast<int>(m_zoomNodes.size())) { return m_zoomNodes[static_cast<size_t>(index)]; }
+
+      auto node = new QSGGeometryNode();
+      auto geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 0);
+      geometry->setDrawingMode(trianglesMode());
+      node->setGeometry(geometry);
+      node->setFlag(QSGNode::OwnsGeometry);
+      node->setMaterial(new QSGTextureMaterial());
+      node->setFlag(QSGNode::OwnsMaterial);
+      // Zoom is drawn below the shade and border
+      insertChildNodeBefore(node, m_spotNode);
+      m_zoomNodes.push_back(node);
+      return node;
+    }
+
+    void removeZoomNodes(int keep)
+    {
+      while (static_cast<int>(m_zoomNodes.size()) > keep)
+      {
+        removeChildNode(m_zoomNodes.back());
+        delete m_zoomNodes.back();
+        m_zoomNodes.pop_back();
+      }
+    }
+
+    QQuickWindow* const m_window;
+    QSGGeometryNode* m_spotNode = nullptr;
+    std::vector<QSGGeometryNode*> m_zoomNodes; // one per visible zoom source tile
+    ZoomTiles m_zoomTiles;
+    std::vector<QSGGeometry::ColoredPoint2D> m_vertices;
+    std::vector<ZoomVertex> m_zoomFan;
+    std::vector<ZoomVertex> m_zoomTriangles;
+    std::vector<ZoomVertex> m_clipPolygon;
+    std::vector<ZoomVertex> m_clipScratch;
+  };
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+  // -----------------------------------------------------------------------------------------------
+  // Half size of the square around the spot center that contains everything that moves with
+  // the spot: the shade corners around the cut-out, border, zoom, dot and anti-aliasing.
+  qreal spotExtent(const SpotFrame& f)
+  {
+    return std::ceil(std::max(f.halfSize, f.dot ? f.dotRadius : 0.0) + fringe) + 1;
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Render node for the software scene graph backend, which does not support custom geometry.
+  ///
+  /// The node only covers the square around the spot (see spotExtent), so when the spot moves
+  /// the software renderer only repaints the old and the new spot area. The shade outside of that
+  /// square is a static rectangle node below. Inside the square, a cached image of the shade
+  /// with cut-out and border replaces the static shade with CompositionMode_Source.
+  class SpotlightPainterNode : public QSGRenderNode
+  {
+  public:
+    explicit SpotlightPainterNode(QQuickWindow* window) : m_window(window) {}
+
+    void setZoomImage(std::shared_ptr<const QImage> zoomImage) { m_zoomImage = std::move(zoomImage); }
+
+    void update(const SpotFrame& frame)
+    {
+      m_frame = frame;
+      const qreal e = spotExtent(frame);
+      m_rect = QRectF(frame.center - QPointF(e, e), QSizeF(2 * e, 2 * e));
+      markDirty(QSGNode::DirtyMaterial);
+    }
+
+    void render(const RenderState* state) override
+    {
+      QSGRendererInterface* const rif = m_window->rendererInterface();
+      auto painter = static_cast<QPainter*>(
+        rif->getResource(m_window, QSGRendererInterface::PainterResource));
+      if (!painter) { return; }
+
+      const QRegion* clipRegion = state->clipRegion();
+      if (clipRegion && !clipRegion->isEmpty()) {
+        painter->setClipRegion(*clipRegion, Qt::ReplaceClip); // must be done before setTransform
+      }
+      painter->setTransform(matrix()->toTransform());
+      painter->setRenderHint(QPainter::Antialiasing);
+      painter->setPen(Qt::NoPen);
+
+      const auto& f = m_frame;
+      const qreal opacity = inheritedOpacity();
+
+      // The cached layer already contains the opacity, Source composition with a painter
+      // opacity below 1 would blend with the static shade below instead of replacing it.
+      painter->setOpacity(1.0);
+      painter->setCompositionMode(QPainter::CompositionMode_Source);
+      painter->drawImage(m_rect.topLeft(), spotLayer(opacity, painter->device()->devicePixelRatioF()));
+      painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+      painter->setOpacity(opacity);
+
+      if (f.zoom && m_zoomImage && !f.windowSize.isEmpty())
+      {
+        painter->save();
+        QPainterPath clipPath;
+        clipPath.addPolygon(toPolygon(f.center, f.border ? f.outlines->inner : f.outlines->outline));
+        painter->setClipPath(clipPath, Qt::IntersectClip);
+        painter->setTransform(zoomTransform(f).inverted(), true);
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, f.smooth);
+        painter->drawImage(QRectF(QPointF(0, 0), f.windowSize), *m_zoomImage);
+        painter->restore();
+      }
+
+      if (f.dot && f.dotRadius > 0)
+      {
+        painter->setBrush(f.dotColor);
+        painter->drawEllipse(f.center, f.dotRadius, f.dotRadius);
+      }
+    }
+
+    StateFlags changedStates() const override { return {}; }
+    RenderingFlags flags() const override { return BoundedRectRendering; }
+    QRectF rect() const override { return m_rect; }
+
+  private:
+    // Shade with spot cut-out and border for the spot square, only re-rendered if the
+    // style, the square size (also depends on the dot), the opacity (during fading) or the
+    // device pixel ratio changes.
+    const QImage& spotLayer(qreal opacity, qreal dpr)
+    {
+      const auto& f = m_frame;
+      const qreal e = spotExtent(f);
+      if (!m_layer.isNull() && m_layerGeneration == f.styleGeneration && qFuzzyCompare(m_layerExtent, e)
+          && qFuzzyCompare(m_layerOpacity, opacity) && qFuzzyCompare(m_layer.devicePixelRatio(), dpr)) {
+        return m_layer;
+      }
+
+      const int pixels = static_cast<int>(std::ceil(2 * e * dpr));
+      m_layer = QImage(pixels, pixels, QImage::Format_ARGB32_Premultiplied);
+      m_layer.setDevicePixelRatio(dpr);
+      m_layer.fill(Qt::transparent);
+
+      QPainter p(&m_layer);
+      p.setRenderHint(QPainter::Antialiasing);
+      p.setOpacity(opacity);
+      const QPointF center(e, e);
+      const QPolygonF outline = toPolygon(center, f.outlines->outline);
+      if (f.shade)
+      {
+        QPainterPath shade;
+        shade.setFillRule(Qt::OddEvenFill);
+        shade.addRect(QRectF(0, 0, 2 * e, 2 * e));
+        shade.addPolygon(outline);
+        p.fillPath(shade, f.shadeColor);
+      }
+      if (f.border)
+      {
+        QPainterPath border;
+        border.setFillRule(Qt::OddEvenFill);
+        border.addPolygon(outline);
+        border.addPolygon(toPolygon(center, f.outlines->inner));
+        p.fillPath(border, f.borderColor);
+      }
+
+      m_layerGeneration = f.styleGeneration;
+      m_layerExtent = e;
+      m_layerOpacity = opacity;
+      return m_layer;
+    }
+
+    QQuickWindow* const m_window;
+    SpotFrame m_frame;
+    QRectF m_rect;
+    std::shared_ptr<const QImage> m_zoomImage;
+
+    QImage m_layer;
+    quint64 m_layerGeneration = 0;
+    qreal m_layerExtent = 0;
+    qreal m_layerOpacity = 1.0;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  /// Scene graph node for the software backend: static shade and the moving spot on top.
+  class SoftwareSpotlightNode : public SpotlightContentNode
+  {
+  public:
+    explicit SoftwareSpotlightNode(QQuickWindow* window)
+      : m_shadeNode(window->createRectangleNode())
+      , m_spotNode(new SpotlightPainterNode(window))
+    {
+      m_shadeNode->setColor(Qt::transparent);
+      appendChildNode(m_shadeNode);
+      appendChildNode(m_spotNode);
+    }
+
+    void update(const SpotFrame& frame) override
+    {
+      // Only touch the shade node on actual changes, every change repaints the whole item.
+      const QColor shadeColor = frame.shade ? frame.shadeColor : QColor(Qt::transparent);
+      if (m_shadeNode->rect() != frame.bounds) { m_shadeNode->setRect(frame.bounds); }
+      if (m_shadeNode->color() != shadeColor) { m_shadeNode->setColor(shadeColor); }
+      m_spotNode->update(frame);
+    }
+
+    void setZoomImage(std::shared_ptr<const QImage> image) override
+    {
+      m_spotNode->setZoomImage(std::move(image));
+    }
+    // The image is drawn directly, the next update() repaints the spot.
+    void zoomImageChanged(const QRect&) override {}
+
+  private:
+    QSGRectangleNode* const m_shadeNode;
+    SpotlightPainterNode* const m_spotNode;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  bool isSoftwareRenderer(QQuickWindow* window)
+  {
+    return window && window->rendererInterface()
+           && window->rendererInterface()->graphicsApi() == QSGRendererInterface::Software;
+  }
+#endif
+
+  // -----------------------------------------------------------------------------------------------
+  SpotlightContentNode* createContentNode(QQuickWindow* window)
+  {
+  #if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    if (isSoftwareRenderer(window)) { return new SoftwareSpotlightNode(window); }
+  #else
+    Q_UNUSED(window)
+  #endif
+    return new SpotlightNode(window);
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  /// Root node of the spotlight item.
+  ///
+  /// With a spot controller, the latest cursor sample and the fade opacity are applied in
+  /// preprocess(), i.e. on the render thread right before the frame is rendered, without a
+  /// round trip through the GUI thread.
+  class SpotlightRootNode : public QSGNode
+  {
+  public:
+    SpotlightRootNode(QQuickWindow* window, SpotlightContentNode* content)
+      : m_window(window)
+      , m_opacityNode(new QSGOpacityNode())
+      , m_content(content)
+    {
+      // Not below the opacity node, preprocess() is not called for nodes in blocked subtrees.
+      setFlag(QSGNode::UsePreprocess);
+      m_opacityNode->appendChildNode(m_content);
+      appendChildNode(m_opacityNode);
+    }
+
+    SpotlightContentNode* content() const { return m_content; }
+
+    // Called during the synchronization with the GUI thread.
+    void setFrame(const SpotFrame& frame, std::shared_ptr<const SpotController::State> state,
+                  const QTransform& globalToItem)
+    {
+      m_frame = frame;
+      m_state = std::move(state);
+      m_globalToItem = globalToItem;
+      m_sampleSequence = 0;
+      m_frameDirty = true;
+    }
+
+    void preprocess() override
+    {
+      if (m_state)
+      {
+        bool animating = false;
+        const qreal opacity = m_state->opacity(SpotController::State::now(), &animating);
+        if (m_opacityNode->opacity() != opacity) { m_opacityNode->setOpacity(opacity); }
+
+        const auto sample = m_state->latestSample();
+        if (sample.sequence != 0 && sample.sequence != m_sampleSequence)
+        {
+          m_sampleSequence = sample.sequence;
+          const QPointF center = m_globalToItem.map(sample.globalPos);
+          m_frameDirty = m_frameDirty || center != m_frame.center;
+          m_frame.center = center;
+        }
+
+        if (animating) { m_window->update(); } // schedule the next frame of the fade
+      }
+
+      if (m_frameDirty) {
+        m_content->update(m_frame);
+        m_frameDirty = false;
+      }
+    }
+
+  private:
+    QQuickWindow* const m_window;
+    QSGOpacityNode* const m_opacityNode;
+    SpotlightContentNode* const m_content;
+    SpotFrame m_frame;
+    bool m_frameDirty = true;
+    std::shared_ptr<const SpotController::State> m_state;
+    QTransform m_globalToItem;
+    quint64 m_sampleSequence = 0;
+  };
+} // end anonymous namespace
+
+// -------------------------------------------------------------------------------------------------
+SpotlightItem::SpotlightItem(QQuickItem* parent) : QQuickItem(parent)
+{
+  setEnabled(false);
+  setFlags(QQuickItem::ItemHasContents);
+}
+
+// -------------------------------------------------------------------------------------------------
+SpotlightItem::~SpotlightItem() = default;
+
+// -------------------------------------------------------------------------------------------------
+int SpotlightItem::qmlRegister()
+{
+  // The controller is provided by the application, the type is only needed for the property.
+  qmlRegisterUncreatableType<SpotController>("Projecteur.Utils", 1, 0, "SpotController",
+                                             QStringLiteral("Provided by the application."));
+  return qmlRegisterType<SpotlightItem>("Projecteur.Utils", 1, 0, "Spotlight");
+}
+
+// -------------------------------------------------------------------------------------------------
+template<typename T>
+void SpotlightItem::setValue(T& member, const T& value, Change change)
+{
+  if (member == value) { return; }
+
+  member = value;
+  if (change != Change::Frame) { ++m_styleGeneration; }
+  if (change == Change::Outline) { m_outlinesDirty = true; }
+  update(); // redraw, schedules updatePaintNode()...
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setCenter(const QPointF& center) { setValue(m_center, center, Change::Frame); }
+void SpotlightItem::setSpotSize(qreal size) { setValue(m_spotSize, std::max(0.0, size), Change::Outline); }
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setShape(const QString& shapeName)
+{
+  m_shapeName = shapeName;
+  setValue(m_shapeParams.shape, SpotShapes::shapeFromName(shapeName), Change::Outline);
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setSquareRadius(int radiusPercentage) {
+  setValue(m_shapeParams.squareRadius, qBound(0, radiusPercentage, 100), Change::Outline);
+}
+void SpotlightItem::setStarPoints(int points) {
+  setValue(m_shapeParams.starPoints, qBound(3, points, 100), Change::Outline);
+}
+void SpotlightItem::setStarInnerRadius(int radiusPercentage) {
+  setValue(m_shapeParams.starInnerRadius, qBound(5, radiusPercentage, 100), Change::Outline);
+}
+void SpotlightItem::setNgonSides(int sides) {
+  setValue(m_shapeParams.ngonSides, qBound(3, sides, 100), Change::Outline);
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setShadeVisible(bool visible) { setValue(m_shadeVisible, visible); }
+void SpotlightItem::setShadeColor(const QColor& color) { setValue(m_shadeColor, color); }
+void SpotlightItem::setShadeOpacity(qreal opacity) { setValue(m_shadeOpacity, opacity); }
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setBorderVisible(bool visible) { setValue(m_borderVisible, visible); }
+void SpotlightItem::setBorderColor(const QColor& color) { setValue(m_borderColor, color); }
+void SpotlightItem::setBorderOpacity(qreal opacity) { setValue(m_borderOpacity, opacity); }
+void SpotlightItem::setBorderSize(int sizePercentage) {
+  setValue(m_borderSize, qBound(0, sizePercentage, 100), Change::Outline);
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setDotVisible(bool visible) { setValue(m_dotVisible, visible, Change::Frame); }
+void SpotlightItem::setDotColor(const QColor& color) { setValue(m_dotColor, color, Change::Frame); }
+void SpotlightItem::setDotOpacity(qreal opacity) { setValue(m_dotOpacity, opacity, Change::Frame); }
+void SpotlightItem::setDotSize(int size) { setValue(m_dotSize, std::max(0, size), Change::Frame); }
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setZoomVisible(bool visible) { setValue(m_zoomVisible, visible, Change::Frame); }
+void SpotlightItem::setZoomFactor(qreal factor) { setValue(m_zoomFactor, std::max(0.1, factor), Change::Frame); }
+
+// -------------------------------------------------------------------------------------------------
+QImage SpotlightItem::zoomSource() const
+{
+  return m_zoomImage ? *m_zoomImage : QImage();
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setZoomSource(const QImage& image)
+{
+  m_zoomImage = image.isNull() ? nullptr : std::make_shared<QImage>(image);
+  m_zoomImageOwned = false;
+  m_zoomSourceDirty = true;
+  m_zoomPatches.clear();
+  update();
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::updateZoomSource(const QImage& image, const QPoint& position)
+{
+  if (!m_zoomImage || !QRect(position, image.size()).intersects(m_zoomImage->rect())) {
+    return;
+  }
+
+  // The zoom source usually shares its pixels with other screens, patches are applied to a copy.
+  // Reading the image here is fine, the render thread only modifies it during the synchronization.
+  if (!m_zoomImageOwned)
+  {
+    m_zoomImage = std::make_shared<QImage>(m_zoomImage->copy());
+    m_zoomImageOwned = true;
+    m_zoomSourceDirty = true;
+  }
+
+  m_zoomPatches.push_back(ZoomPatch{image, position});
+  if (m_zoomPatches.size() > MaxZoomPatches)
+  {
+    // Not synchronized for a while (e.g. the window is not exposed), merge the patches.
+    QRect bounds;
+    for (const auto& patch : m_zoomPatches) { bounds |= QRect(patch.position, patch.image.size()); }
+    bounds &= m_zoomImage->rect();
+    QImage merged = m_zoomImage->copy(bounds);
+    merged.setDevicePixelRatio(1.0);
+    for (const auto& patch : m_zoomPatches) {
+      copyPixels(merged, patch.position - bounds.topLeft(), patch.image);
+    }
+    m_zoomPatches.clear();
+    m_zoomPatches.push_back(ZoomPatch{merged, bounds.topLeft()});
+  }
+  update();
+}
+
+// -------------------------------------------------------------------------------------------------
+std::shared_ptr<const SpotOutlines> SpotlightItem::outlines()
+{
+  if (m_outlinesDirty) {
+    m_outlines = spotOutlines(m_shapeParams, m_spotSize, (100 - m_borderSize) / 100.0);
+    m_outlinesDirty = false;
+  }
+  return m_outlines;
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::setController(SpotController* controller)
+{
+  if (m_controller == controller) { return; }
+
+  m_controller = controller;
+  if (m_controller && m_window) { m_controller->attachWindow(m_window); }
+  update();
+}
+
+// -------------------------------------------------------------------------------------------------
+QTransform SpotlightItem::itemToScene() const
+{
+  const QPointF m0 = mapToScene(QPointF(0, 0));
+  const QPointF m1 = mapToScene(QPointF(1, 0));
+  const QPointF m2 = mapToScene(QPointF(0, 1));
+  return QTransform(m1.x() - m0.x(), m1.y() - m0.y(), m2.x() - m0.x(), m2.y() - m0.y(), m0.x(), m0.y());
+}
+
+// -------------------------------------------------------------------------------------------------
+void SpotlightItem::itemChange(ItemChange change, const ItemChangeData& value)
+{
+  if (change == ItemSceneChange)
+  {
+    if (m_window) { disconnect(m_window, nullptr, this, nullptr); }
+    m_window = value.window;
+    if (m_window)
+    {
+      // Cursor samples are in global coordinates, the mapping changes with the window position.
+      connect(m_window, &QWindow::xChanged, this, &QQuickItem::update);
+      connect(m_window, &QWindow::yChanged, this, &QQuickItem::update);
+      if (m_controller) { m_controller->attachWindow(m_window); }
+    }
+  }
+  QQuickItem::itemChange(change, value);
+}
+
+// -------------------------------------------------------------------------------------------------
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+void SpotlightItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+  QQuickItem::geometryChange(newGeometry, oldGeometry);
+  update();
+}
+#else
+void SpotlightItem::geometryChanged(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+  QQuickItem::geometryChanged(newGeometry, oldGeometry);
+  update();
+}
+#endif
+
+// -------------------------------------------------------------------------------------------------
+QSGNode* SpotlightItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData)
+{
+  Q_UNUSED(updatePaintNodeData)
+
+  if (width() <= 0 || height() <= 0 || m_spotSize <= 0) {
+    delete oldNode;
+    return nullptr;
+  }
+
+  SpotFrame frame;
+  frame.bounds = QRectF(0, 0, width(), height());
+  frame.center = m_center;
+  frame.halfSize = m_spotSize / 2;
+  frame.outlines = outlines();
+  frame.shade = m_shadeVisible;
+  frame.border = m_borderVisible && m_borderSize > 0;
+  frame.dot = m_dotVisible;
+  frame.zoom = m_zoomVisible && m_zoomImage;
+  frame.shadeColor = withOpacity(m_shadeColor, m_shadeOpacity);
+  frame.borderColor = withOpacity(m_borderColor, m_borderOpacity);
+  frame.dotColor = withOpacity(m_dotColor, m_dotOpacity);
+  frame.dotRadius = m_dotSize / 2.0;
+  if (frame.dot && frame.dotRadius > 0)
+  {
+    if (!m_dotOutlines || m_dotOutlines->radius != frame.dotRadius) {
+      m_dotOutlines = dotOutlines(frame.dotRadius);
+    }
+    frame.dotOutlines = m_dotOutlines;
+  }
+  frame.styleGeneration = m_styleGeneration;
+  frame.zoomFactor = m_zoomFactor;
+  frame.itemToScene = itemToScene();
+  frame.smooth = smooth();
+  if (frame.zoom) {
+    frame.windowSize = window()->size();
+  }
+
+  auto node = static_cast<SpotlightRootNode*>(oldNode);
+  if (!node) {
+    node = new SpotlightRootNode(window(), createContentNode(window()));
+    m_zoomSourceDirty = true;
+  }
+
+  // The render thread does not read the zoom image right now, it is our thread or waiting for it.
+  QRect changed;
+  for (const auto& patch : m_zoomPatches)
+  {
+    copyPixels(*m_zoomImage, patch.position, patch.image);
+    changed |= QRect(patch.position, patch.image.size());
+  }
+  m_zoomPatches.clear();
+
+  if (m_zoomSourceDirty) {
+    node->content()->setZoomImage(m_zoomImage);
+    m_zoomSourceDirty = false;
+  }
+  else if (!changed.isEmpty()) {
+    node->content()->zoomImageChanged(changed);
+  }
+
+  QTransform globalToItem;
+  std::shared_ptr<const SpotController::State> state;
+  if (m_controller)
+  {
+    state = m_controller->state();
+    const QPoint windowPos = window()->position();
+    globalToItem = (frame.itemToScene * QTransform::fromTranslate(windowPos.x(), windowPos.y())).inverted();
+  }
+  node->setFrame(frame, std::move(state), globalToItem);
+  return node;
+}
@@ -0,0 +1,171 @@
+// This file is part of Projecteur - https://github.com/jahnf/projecteur
+// - See LICENSE.md and README.md
+#pragma once
+
+#include "spotcontroller.h"
+#include "spotshapes.h"
+
+#include <QColor>
+#include <QImage>
+#include <QPointer>
+#include <QQuickItem>
+
+#include <memory>
+#include <vector>
+
+struct SpotOutlines;
+struct DotOutlines;
+
+/// Spotlight overlay item: draws the shade with the spot cut-out, the spot border and
+/// the center dot in one geometry node. The optional zoomed desktop inside the spot is drawn
+/// with separate textured nodes on top of it.
+/// With the software scene graph backend the same is painted with QPainter.
+///
+/// If a spot controller is set, the spot follows its cursor samples on the render thread and
+/// the center property is only used until the first sample; the controller also fades the item.
+class SpotlightItem : public QQuickItem
+{
+  Q_OBJECT
+  Q_PROPERTY(SpotController* controller READ controller WRITE setController)
+  Q_PROPERTY(QPointF center READ center WRITE setCenter)
+  Q_PROPERTY(qreal spotSize READ spotSize WRITE setSpotSize)
+  Q_PROPERTY(QString shape READ shape WRITE setShape)
+  Q_PROPERTY(int squareRadius READ squareRadius WRITE setSquareRadius)
+  Q_PROPERTY(int starPoints READ starPoints WRITE setStarPoints)
+  Q_PROPERTY(int starInnerRadius READ starInnerRadius WRITE setStarInnerRadius)
+  Q_PROPERTY(int ngonSides READ ngonSides WRITE setNgonSides)
+  Q_PROPERTY(bool shadeVisible READ shadeVisible WRITE setShadeVisible)
+  Q_PROPERTY(QColor shadeColor READ shadeColor WRITE setShadeColor)
+  Q_PROPERTY(qreal shadeOpacity READ shadeOpacity WRITE setShadeOpacity)
+  Q_PROPERTY(bool borderVisible READ borderVisible WRITE setBorderVisible)
+  Q_PROPERTY(QColor borderColor READ borderColor WRITE setBorderColor)
+  Q_PROPERTY(qreal borderOpacity READ borderOpacity WRITE setBorderOpacity)
+  Q_PROPERTY(int borderSize READ borderSize WRITE setBorderSize)
+  Q_PROPERTY(bool dotVisible READ dotVisible WRITE setDotVisible)
+  Q_PROPERTY(QColor dotColor READ dotColor WRITE setDotColor)
+  Q_PROPERTY(qreal dotOpacity READ dotOpacity WRITE setDotOpacity)
+  Q_PROPERTY(int dotSize READ dotSize WRITE setDotSize)
+  Q_PROPERTY(bool zoomVisible READ zoomVisible WRITE setZoomVisible)
+  Q_PROPERTY(qreal zoomFactor READ zoomFactor WRITE setZoomFactor)
+  Q_PROPERTY(QImage zoomSource READ zoomSource WRITE setZoomSource)
+
+public:
+  static int qmlRegister();
+
+  explicit SpotlightItem(QQuickItem* parent = nullptr);
+  ~SpotlightItem() override;
+
+  SpotController* controller() const { return m_controller; }
+  void setController(SpotController* controller);
+
+  QPointF center() const { return m_center; }
+  void setCenter(const QPointF& center);
+  qreal spotSize() const { return m_spotSize; }
+  void setSpotSize(qreal size);
+
+  QString shape() const { return m_shapeName; }
+  void setShape(const QString& shapeName);
+  int squareRadius() const { return m_shapeParams.squareRadius; }
+  void setSquareRadius(int radiusPercentage);
+  int starPoints() const { return m_shapeParams.starPoints; }
+  void setStarPoints(int points);
+  int starInnerRadius() const { return m_shapeParams.starInnerRadius; }
+  void setStarInnerRadius(int radiusPercentage);
+  int ngonSides() const { return m_shapeParams.ngonSides; }
+  void setNgonSides(int sides);
+
+  bool shadeVisible() const { return m_shadeVisible; }
+  void setShadeVisible(bool visible);
+  QColor shadeColor() const { return m_shadeColor; }
+  void setShadeColor(const QColor& color);
+  qreal shadeOpacity() const { return m_shadeOpacity; }
+  void setShadeOpacity(qreal opacity);
+
+  bool borderVisible() const { return m_borderVisible; }
+  void setBorderVisible(bool visible);
+  QColor borderColor() const { return m_borderColor; }
+  void setBorderColor(const QColor& color);
+  qreal borderOpacity() const { return m_borderOpacity; }
+  void setBorderOpacity(qreal opacity);
+  int borderSize() const { return m_borderSize; }
+  void setBorderSize(int sizePercentage);
+
+  bool dotVisible() const { return m_dotVisible; }
+  void setDotVisible(bool visible);
+  QColor dotColor() const { return m_dotColor; }
+  void setDotColor(const QColor& color);
+  qreal dotOpacity() const { return m_dotOpacity; }
+  void setDotOpacity(qreal opacity);
+  int dotSize() const { return m_dotSize; }
+  void setDotSize(int size);
+
+  bool zoomVisible() const { return m_zoomVisible; }
+  void setZoomVisible(bool visible);
+  qreal zoomFactor() const { return m_zoomFactor; }
+  void setZoomFactor(qreal factor);
+  QImage zoomSource() const;
+  void setZoomSource(const QImage& image);
+  /// Replace the pixels of the zoom source at position with image, e.g. for live zoom.
+  void updateZoomSource(const QImage& image, const QPoint& position);
+
+protected:
+  QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData) override;
+  void itemChange(ItemChange change, const ItemChangeData& value) override;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+  void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+#else
+  void geometryChanged(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+#endif
+
+private:
+  enum class Change {
+    Frame,   ///< Only the current frame changes (position, zoom, center dot)
+    Style,   ///< Cached shade and border layers are invalid
+    Outline, ///< Cached spot outline and layers are invalid
+  };
+  template<typename T> void setValue(T& member, const T& value, Change change = Change::Style);
+
+  struct ZoomPatch
+  {
+    QImage image;
+    QPoint position; ///< Pixel position inside the zoom source
+  };
+  static constexpr size_t MaxZoomPatches = 32;
+
+  std::shared_ptr<const SpotOutlines> outlines();
+  QTransform itemToScene() const;
+
+  QPointer<SpotController> m_controller;
+  QPointer<QQuickWindow> m_window;
+  QPointF m_center;
+  qreal m_spotSize = 0;
+
+  QString m_shapeName;
+  SpotShapes::Parameters m_shapeParams;
+  std::shared_ptr<const SpotOutlines> m_outlines; // for m_shapeParams, m_spotSize and m_borderSize
+  bool m_outlinesDirty = true;
+  quint64 m_styleGeneration = 0;
+
+  bool m_shadeVisible = true;
+  QColor m_shadeColor = Qt::black;
+  qreal m_shadeOpacity = 0.3;
+
+  bool m_borderVisible = false;
+  QColor m_borderColor = Qt::black;
+  qreal m_borderOpacity = 0.8;
+  int m_borderSize = 3;
+
+  bool m_dotVisible = true;
+  QColor m_dotColor = Qt::red;
+  qreal m_dotOpacity = 0.8;
+  int m_dotSize = 5;
+  std::shared_ptr<const DotOutlines> m_dotOutlines;
+
+  bool m_zoomVisible = false;
+  qreal m_zoomFactor = 1.5;
+  // Shared with the render thread, only modified during the synchronization with it.
+  std::shared_ptr<QImage> m_zoomImage;
+  bool m_zoomImageOwned = false; // no other image shares the pixels, patches can be applied
+  bool m_zoomSourceDirty = false;
+  std::vector<ZoomPatch> m_zoomPatches; // changes since the last sync with the render thread
+};
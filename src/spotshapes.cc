@@ -3,258 +3,149 @@
 
 #include "spotshapes.h"
 
-#include <QSGFlatColorMaterial>
-#include <QSGGeometryNode>
+#include <QtMath>
 
+#include <algorithm>
 #include <cmath>
+#include <map>
+#include <mutex>
 
 namespace {
-  const bool registered = [](){
-    SpotShapeStar::qmlRegister();
-    SpotShapeNGon::qmlRegister();
-    return true;
-  }();
-} // end anonymous namespace
-
-SpotShapeStar::SpotShapeStar(QQuickItem* parent) : QQuickItem (parent)
-{
-  setEnabled(false);
-  setFlags(QQuickItem::ItemHasContents);
-}
-
-int SpotShapeStar::qmlRegister()
-{
-  return qmlRegisterType<SpotShapeStar>("Projecteur.Shapes", 1, 0, "Star");
-}
+  // -----------------------------------------------------------------------------------------------
+  constexpr qreal startAngle = -M_PI / 2; // First point of all shapes is at the top
 
-QSGNode* SpotShapeStar::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData)
-{
-  if (width() <= 0 || height() <= 0 || m_color.alpha() == 0) {
-    delete oldNode;
-    return nullptr;
+  // -----------------------------------------------------------------------------------------------
+  // Number of segments for round outlines, depending on the radius in pixels.
+  int arcSegments(qreal radius, qreal arcAngle)
+  {
+    // Keep the deviation of a segment from the arc below ~0.25 px
+    const qreal maxAngle = (radius > 0.5) ? 2 * std::acos(std::max(0.0, 1 - 0.25 / radius)) : M_PI;
+    return qBound(2, static_cast<int>(std::ceil(arcAngle / maxAngle)), 256);
   }
 
-  // Directly access the QSG transformnode for the Items node: updatePaintNodeData->transformNode->...;
-  Q_UNUSED(updatePaintNodeData)
-
-  const auto vertexCount = m_points*2+2;
-
-  // Create geometry node for colored shape
-  auto geometryNode = static_cast<QSGGeometryNode *>(oldNode);
-  if (geometryNode == nullptr)
+  // -----------------------------------------------------------------------------------------------
+  // Points of the unit circle divided into the given number of segments, beginning at the top.
+  // Tables are computed once per segment count, shapes only scale them.
+  const QVector<QPointF>& unitCircle(int segments)
   {
-    geometryNode = new QSGGeometryNode();
-
-    // Set geometry
-    const auto geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), vertexCount);
-
-    #if QT_VERSION >= 0x050800
-      geometry->setDrawingMode(QSGGeometry::DrawTriangleFan);
-    #else
-      geometry->setDrawingMode(GL_TRIANGLE_FAN);
-    #endif
-    geometryNode->setGeometry(geometry);
-    geometryNode->setFlag(QSGNode::OwnsGeometry, true);
-
-    auto* const material = new QSGFlatColorMaterial();
-    material->setColor(m_color);
-    geometryNode->setMaterial(material);
-    geometryNode->setFlag(QSGNode::OwnsMaterial);
-  }
-  else {
-    const auto geometry = geometryNode->geometry();
-    if (geometry->vertexCount() != vertexCount) {
-      geometry->allocate(vertexCount);
-    }
-    if (auto material = static_cast<QSGFlatColorMaterial*>(geometryNode->material())) {
-      material->setColor(m_color);
+    static std::mutex mutex;
+    static std::map<int, QVector<QPointF>> tables; // elements are never removed or modified
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& table = tables[segments];
+    if (table.isEmpty())
+    {
+      table.reserve(segments);
+      for (int i = 0; i < segments; ++i) {
+        const qreal theta = startAngle + 2 * M_PI * i / segments;
+        table.push_back({std::cos(theta), std::sin(theta)});
+      }
     }
+    return table;
   }
 
-  QSGGeometry::Point2D* const vertices = geometryNode->geometry()->vertexDataAsPoint2D();
-  const int numSegments = m_points * 2;
-  const auto cx = static_cast<float>(width()/2); // center X
-  const auto cy = static_cast<float>(height()/2); // center Y
-  const auto deltaRad = static_cast<float>((360.0 / m_points) * (M_PI/180.0));
-  float theta = -static_cast<float>(90.0 * M_PI/180.0);
-
-  vertices[0].set(cx, cy);
-  // Vertices for (outer) star points
-  for(int seg=1; seg < numSegments; seg+=2, theta+=deltaRad)
+  // -----------------------------------------------------------------------------------------------
+  QVector<QPointF> circleOutline(qreal radius)
   {
-    const float x = cx * cosf(theta);
-    const float y = cy * sinf(theta);
-    vertices[seg].set(x + cx, y + cy);
+    // Multiple of 8, so that the diagonals and axes are always points of the outline
+    const int segments = ((arcSegments(radius, 2 * M_PI) + 7) / 8) * 8;
+    QVector<QPointF> points;
+    points.reserve(segments);
+    for (const auto& p : unitCircle(segments)) { points.push_back(p * radius); }
+    return points;
   }
 
-  const float dist0_1 = std::sqrt(std::pow(vertices[0].x-vertices[1].x, 2.0f)
-                                  + std::pow(vertices[0].y-vertices[1].y, 2.0f));
-  const float dist1_3_2 = std::sqrt(std::pow(vertices[1].x-vertices[3].x, 2.0f)
-                                    + std::pow(vertices[1].y-vertices[3].y, 2.0f)) / 2.0f;
+  // -----------------------------------------------------------------------------------------------
+  QVector<QPointF> squareOutline(qreal halfSize, int radiusPercent)
+  {
+    const qreal r = halfSize * qBound(0, radiusPercent, 100) / 100.0;
+    const qreal inner = halfSize - r; // distance of the corner arc centers from the center
+
+    QVector<QPointF> points;
+    if (r < 0.5) {
+      points = {{0, -halfSize}, {halfSize, -halfSize}, {halfSize, halfSize},
+                {-halfSize, halfSize}, {-halfSize, -halfSize}};
+      return points;
+    }
 
-  const float maxInnerDist = std::sqrt(std::pow(dist0_1,2.0f) - std::pow(dist1_3_2, 2.0f));
-  const float innerDistance = maxInnerDist * float(m_innerRadius)/100.0f;
+    const int segments = arcSegments(r, M_PI / 2);
+    const auto& circle = unitCircle(4 * segments);
+    points.reserve(4 * (segments + 1) + 1);
+    points.push_back({0, -halfSize});
+    // Corner arcs clockwise beginning with the top right corner
+    const QPointF centers[] = {{inner, -inner}, {inner, inner}, {-inner, inner}, {-inner, -inner}};
+    for (int corner = 0; corner < 4; ++corner)
+    {
+      for (int i = 0; i <= segments; ++i) {
+        points.push_back(centers[corner] + circle[(corner * segments + i) % circle.size()] * r);
+      }
+    }
+    return points;
+  }
 
-  // Vertices for inner radius
-  theta = -static_cast<float>(90.0 * M_PI/180.0) + deltaRad/2 ;
-  for(int seg=2; seg < numSegments+1; seg+=2, theta+=deltaRad)
+  // -----------------------------------------------------------------------------------------------
+  QVector<QPointF> starOutline(qreal radius, int starPoints, int innerRadiusPercent)
   {
-    const float x = innerDistance * std::cos(theta);
-    const float y = innerDistance * std::sin(theta);
-    vertices[seg].set(x + cx, y + cy);
+    const int n = qBound(3, starPoints, 100);
+    const qreal deltaRad = 2 * M_PI / n;
+    // The maximum inner radius is the distance of the center to the line between two points
+    const qreal innerRadius = radius * std::cos(deltaRad / 2) * qBound(5, innerRadiusPercent, 100) / 100.0;
+
+    // Outer points at the even, inner points at the odd angles
+    const auto& circle = unitCircle(2 * n);
+    QVector<QPointF> points;
+    points.reserve(2 * n);
+    for (int i = 0; i < n; ++i)
+    {
+      points.push_back(circle[2 * i] * radius);
+      points.push_back(circle[2 * i + 1] * innerRadius);
+    }
+    return points;
   }
 
-  vertices[vertexCount-1] = vertices[1]; // last star point = first star point
-
-  geometryNode->markDirty(QSGGeometryNode::DirtyGeometry);
-  return geometryNode;
-}
-
-QColor SpotShapeStar::color() const
-{
-  return m_color;
-}
-
-void SpotShapeStar::setColor(const QColor &color)
-{
-  if (m_color == color)
-    return;
-
-  m_color = color;
-  emit colorChanged(color);
-  update(); // redraw, schedules updatePaintNode()...
-}
-
-int SpotShapeStar::points() const
-{
-  return m_points;
-}
-
-void SpotShapeStar::setPoints(int points)
-{
-  if (m_points == points)
-    return;
-
-  m_points = qMin(qMax(3, points), 100);
-  emit pointsChanged(m_points);
-  update(); // redraw, schedules updatePaintNode()...
-}
-
-int SpotShapeStar::innerRadius() const
-{
-  return m_innerRadius;
-}
-
-void SpotShapeStar::setInnerRadius(int radiusPercentage)
-{
-  if (radiusPercentage > m_innerRadius || radiusPercentage < m_innerRadius)
+  // -----------------------------------------------------------------------------------------------
+  QVector<QPointF> ngonOutline(qreal radius, int sides)
   {
-    m_innerRadius = qMin(qMax(5, radiusPercentage), 100);
-    emit innerRadiusChanged(m_innerRadius);
-    update(); // redraw, schedules updatePaintNode()...
+    const int n = qBound(3, sides, 100);
+    QVector<QPointF> points;
+    points.reserve(n);
+    for (const auto& p : unitCircle(n)) { points.push_back(p * radius); }
+    return points;
   }
-}
-
-SpotShapeNGon::SpotShapeNGon(QQuickItem* parent) : QQuickItem (parent)
-{
-  setEnabled(false);
-  setFlags(QQuickItem::ItemHasContents);
-}
-
-int SpotShapeNGon::qmlRegister()
-{
-  return qmlRegisterType<SpotShapeNGon>("Projecteur.Shapes", 1, 0, "NGon");
-}
-
-QColor SpotShapeNGon::color() const
-{
-  return m_color;
-}
-
-void SpotShapeNGon::setColor(const QColor &color)
-{
-  if (m_color == color)
-    return;
+} // end anonymous namespace
 
-  m_color = color;
-  emit colorChanged(color);
-  update(); // redraw, schedules updatePaintNode()...
-}
+namespace SpotShapes {
 
-int SpotShapeNGon::sides() const
+// -------------------------------------------------------------------------------------------------
+bool Parameters::operator==(const Parameters& o) const
 {
-  return m_sides;
+  return shape == o.shape && squareRadius == o.squareRadius && starPoints == o.starPoints
+         && starInnerRadius == o.starInnerRadius && ngonSides == o.ngonSides;
 }
 
-void SpotShapeNGon::setSides(int sides)
+// -------------------------------------------------------------------------------------------------
+Shape shapeFromName(const QString& name)
 {
-  if (m_sides == sides)
-    return;
-
-  m_sides = qMin(qMax(3, sides), 100);
-  emit sidesChanged(m_sides);
-  update(); // redraw, schedules updatePaintNode()...
+  if (name == "Square") { return Shape::Square; }
+  if (name == "Star") { return Shape::Star; }
+  if (name == "Ngon") { return Shape::NGon; }
+  return Shape::Circle;
 }
 
-QSGNode* SpotShapeNGon::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData)
+// -------------------------------------------------------------------------------------------------
+QVector<QPointF> outline(const Parameters& params, qreal size)
 {
-  if (width() <= 0 || height() <= 0 || m_color.alpha() == 0) {
-    delete oldNode;
-    return nullptr;
-  }
-
-  // Directly access the QSG transformnode for the Items node: updatePaintNodeData->transformNode->...;
-  Q_UNUSED(updatePaintNodeData)
-
-  const auto vertexCount = m_sides + 2;
-
-  // Create geometry node for colored shape
-  auto geometryNode = static_cast<QSGGeometryNode *>(oldNode);
-  if (geometryNode == nullptr)
-  {
-    geometryNode = new QSGGeometryNode();
-
-    // Set geometry
-    const auto geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), vertexCount);
+  const qreal halfSize = size / 2;
+  if (halfSize <= 0) { return {}; }
 
-    #if QT_VERSION >= 0x050800
-      geometry->setDrawingMode(QSGGeometry::DrawTriangleFan);
-    #else
-      geometry->setDrawingMode(GL_TRIANGLE_FAN);
-    #endif
-    geometryNode->setGeometry(geometry);
-    geometryNode->setFlag(QSGNode::OwnsGeometry, true);
-
-    const auto material = new QSGFlatColorMaterial();
-    material->setColor(m_color);
-    geometryNode->setMaterial(material);
-    geometryNode->setFlag(QSGNode::OwnsMaterial);
-  }
-  else {
-    const auto geometry = geometryNode->geometry();
-    if (geometry->vertexCount() != vertexCount) {
-      geometry->allocate(vertexCount);
-    }
-    if (auto material = static_cast<QSGFlatColorMaterial*>(geometryNode->material())) {
-      material->setColor(m_color);
-    }
-  }
-
-  QSGGeometry::Point2D* const vertices = geometryNode->geometry()->vertexDataAsPoint2D();
-  const auto cx = static_cast<float>(width()/2); // center X
-  const auto cy = static_cast<float>(height()/2); // center Y
-  const auto deltaRad = static_cast<float>((360.0 / m_sides) * (M_PI/180.0));
-  float theta = -static_cast<float>(90.0 * M_PI/180.0);
-
-  vertices[0].set(cx, cy);
-  for(int seg=1; seg < vertexCount; ++seg, theta+=deltaRad)
+  switch (params.shape)
   {
-    const float x = cx * cosf(theta);
-    const float y = cy * sinf(theta);
-    vertices[seg].set(x + cx, y + cy);
+  case Shape::Square: return squareOutline(halfSize, params.squareRadius);
+  case Shape::Star: return starOutline(halfSize, params.starPoints, params.starInnerRadius);
+  case Shape::NGon: return ngonOutline(halfSize, params.ngonSides);
+  case Shape::Circle: break;
   }
-  vertices[vertexCount-1] = vertices[1]; // last shape point = first shape point
-
-  geometryNode->markDirty(QSGGeometryNode::DirtyGeometry);
-  return geometryNode;
+  return circleOutline(halfSize);
 }
+
+} // end namespace SpotShapes
@@ -2,68 +2,40 @@
 // - See LICENSE.md and README.md
 #pragma once
 
-#include <QQuickItem>
-
-class SpotShapeStar : public QQuickItem
-{
-  Q_OBJECT
-  Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
-  Q_PROPERTY(int points READ points WRITE setPoints NOTIFY pointsChanged)
-  Q_PROPERTY(int innerRadius READ innerRadius WRITE setInnerRadius NOTIFY innerRadiusChanged)
-
-public:
-  static int qmlRegister();
-
-  explicit SpotShapeStar(QQuickItem* parent = nullptr);
-
-  QColor color() const;
-  void setColor(const QColor &color);
-
-  int points() const;
-  void setPoints(int points);
-
-  int innerRadius() const; // inner star radius in percent (between 5 and 100)
-  void setInnerRadius(int radiusPercentage);
-
-signals:
-  void colorChanged(QColor color);
-  void pointsChanged(int points);
-  void innerRadiusChanged(int innerRadius);
-
-protected:
-  virtual QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData) override;
-
-private:
-  QColor m_color = Qt::black;
-  int m_points = 3;
-  int m_innerRadius = 50;
-};
-
-class SpotShapeNGon : public QQuickItem
+#include <QPointF>
+#include <QString>
+#include <QVector>
+
+/// Analytic outlines of the spotlight shapes.
+///
+/// All shapes are star-shaped around their center, i.e. every ray from the center crosses the
+/// outline exactly once. Outlines are returned as polygons centered at (0,0), starting at the top
+/// and going clockwise (in screen coordinates); the last point is not repeated.
+namespace SpotShapes
 {
-  Q_OBJECT
-  Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
-  Q_PROPERTY(int sides READ sides WRITE setSides NOTIFY sidesChanged)
-
-public:
-  static int qmlRegister();
-
-  explicit SpotShapeNGon(QQuickItem* parent = nullptr);
-
-  QColor color() const;
-  void setColor(const QColor &color);
-
-  int sides() const;
-  void setSides(int points);
-
-signals:
-  void colorChanged(QColor color);
-  void sidesChanged(int sides);
-
-protected:
-  virtual QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData) override;
-
-private:
-  QColor m_color = Qt::black;
-  int m_sides = 3;
-};
+  enum class Shape {
+    Circle,
+    Square,
+    Star,
+    NGon,
+  };
+
+  struct Parameters
+  {
+    Shape shape = Shape::Circle;
+    int squareRadius = 20;    ///< Border radius of the (rounded) square in percent (0-100)
+    int starPoints = 5;       ///< Number of star points (3-100)
+    int starInnerRadius = 50; ///< Inner star radius in percent (between 5 and 100)
+    int ngonSides = 3;        ///< Number of N-gon sides (3-100)
+
+    bool operator==(const Parameters& o) const;
+    bool operator!=(const Parameters& o) const { return !(*this == o); }
+  };
+
+  /// Return the shape for a shape name as used in the settings, e.g. 'Star'. Unknown names
+  /// result in a circle.
+  Shape shapeFromName(const QString& name);
+
+  /// Return the outline for the shape fitted into a square with the given size.
+  QVector<QPointF> outline(const Parameters& params, qreal size);
+}
@@ -3,49 +3,381 @@
 
 #include "virtualdevice.h"
 
+#include "device-defs.h"
 #include "logging.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <linux/uinput.h>
 #include <linux/input-event-codes.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <deque>
+#include <functional>
+
+#include <QCoreApplication>
 #include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
 
 LOGGING_CATEGORY(virtualdevice, "virtualdevice")
 
-// KEY_MACRO1 is only defined in newer linux versions
-#ifndef KEY_MACRO1
-#define KEY_MACRO1 0x290
-#endif
-
 namespace  {
   class VirtualDevice_ : public QObject {}; // for i18n and logging
+
+  // Time for udev and libinput to open a new uinput device, events written before are lost.
+  constexpr int DeviceSettleTimeMs = 500;
+
+  struct UinputDevice {
+    int fd = -1;
+    QString sysName;
+  };
+
+  // -----------------------------------------------------------------------------------------------
+  // Create a uinput device that advertises exactly the given capabilities.
+  UinputDevice createUinputDevice(const VirtualDevice::Setup& setup,
+                                  const VirtualDevice::Capabilities& caps)
+  {
+    const int fd = ::open(setup.location.constData(), O_WRONLY | O_NDELAY);
+    if (fd < 0) {
+      logWarn(virtualdevice) << VirtualDevice_::tr("Unable to open: %1").arg(setup.location.constData());
+      logWarn(virtualdevice) << VirtualDevice_::tr("Please check if current user has write access");
+      return {};
+    }
+
+    // Setup the uinput device with the required event codes only
+    // (see all in Linux's input-event-codes.h)
+    ioctl(fd, UI_SET_EVBIT, EV_SYN);
+    if (caps.keys.any()) {
+      ioctl(fd, UI_SET_EVBIT, EV_KEY);
+      for (size_t i = 0; i < caps.keys.size(); ++i) {
+        if (caps.keys[i]) { ioctl(fd, UI_SET_KEYBIT, i); }
+      }
+    }
+    if (caps.rels.any()) {
+      ioctl(fd, UI_SET_EVBIT, EV_REL);
+      for (size_t i = 0; i < caps.rels.size(); ++i) {
+        if (caps.rels[i]) { ioctl(fd, UI_SET_RELBIT, i); }
+      }
+    }
+
+    // Thank's to Matthias Blümel / https://github.com/Blaimi
+    // for the detailed investigation on the uinput issue on newer
+    // Linux distributions.
+    // See https://github.com/jahnf/Projecteur/issues/175#issuecomment-1432112896
+
+    bool setupDone = false;
+  #ifdef UI_DEV_SETUP
+    struct uinput_setup usetup {};
+    snprintf(usetup.name, sizeof(usetup.name), "%s", setup.name.constData());
+    usetup.id.bustype = BUS_USB;
+    usetup.id.vendor = setup.vendorId;
+    usetup.id.product = setup.productId;
+    usetup.id.version = setup.versionId;
+    setupDone = (ioctl(fd, UI_DEV_SETUP, &usetup) == 0);
+  #endif
+
+    if (!setupDone)
+    { // Kernels before 4.5 only support the device setup via write
+      struct uinput_user_dev uinp {};
+      snprintf(uinp.name, sizeof(uinp.name), "%s", setup.name.constData());
+      uinp.id.bustype = BUS_USB;
+      uinp.id.vendor = setup.vendorId;
+      uinp.id.product = setup.productId;
+      uinp.id.version = setup.versionId;
+      const auto bytesWritten = write(fd, &uinp, sizeof(uinp));
+      setupDone = (bytesWritten == sizeof(uinp));
+    }
+
+    // Create input device into input sub-system
+    if (!setupDone || ioctl(fd, UI_DEV_CREATE))
+    {
+      ::close(fd);
+      logWarn(virtualdevice) << VirtualDevice_::tr("Unable to create Virtual (UINPUT) device.");
+      return {};
+    }
+
+    // Log the device name
+    char sysfs_device_name[16]{};
+    ioctl(fd, UI_GET_SYSNAME(sizeof(sysfs_device_name)), sysfs_device_name);
+    logInfo(virtualdevice) << VirtualDevice_::tr("Created uinput device: %1 (%2 key codes, %3 axes)")
+                              .arg(QString("%1; /sys/devices/virtual/input/%2")
+                                .arg(setup.name.constData(), sysfs_device_name))
+                              .arg(caps.keys.count()).arg(caps.rels.count());
+
+    return {fd, QString(sysfs_device_name)};
+  }
+
+  // -----------------------------------------------------------------------------------------------
+  void destroyUinputDevice(int fd)
+  {
+    ioctl(fd, UI_DEV_DESTROY);
+    ::close(fd);
+  }
 } // end anonymous namespace
 
 struct VirtualDevice::Token {};
 
 // -------------------------------------------------------------------------------------------------
-VirtualDevice::VirtualDevice(Token /* token */, int fd, const char* name, const char* sysfs_name)
-  : m_uinpFd(fd)
-  , m_userName(name)
-  , m_deviceName(sysfs_name)
+/// Writes event frames to the uinput device. Frames that cannot be written completely are
+/// queued and written once the device is writable again, starting with the remaining bytes of
+/// a partially written frame, so frames never get interleaved.
+/// After a write error only frames with key releases are kept, for the next device set with setFd().
+/// The owner is notified about write errors to replace the device.
+struct VirtualDevice::Writer
+{
+  /// Maximum number of queued frames. The limit is only exceeded to keep key releases.
+  static constexpr size_t MaxQueuedFrames = 256;
+
+  struct Frame
+  {
+    std::vector<input_event> events;
+    bool hasRelease = false;
+  };
+
+  Writer(const QByteArray& name, std::function<void(int fd)> onWriteError)
+    : m_name(name), m_onWriteError(std::move(onWriteError)) {}
+
+  void setFd(int fd);
+  void write(const input_event events[], size_t num);
+  void flush();
+
+  const WriteStats& stats() const { return m_stats; }
+  size_t pendingFrames() const { return m_queue.size(); }
+
+private:
+  ssize_t writeBytes(const char* data, size_t size);
+  void enqueue(Frame&& frame);
+  void drop(size_t frames, const char* reason);
+  void setWriteError();
+
+  const QByteArray m_name;
+  const std::function<void(int fd)> m_onWriteError;
+  int m_fd = -1;
+  std::deque<Frame> m_queue;
+  size_t m_headOffset = 0; // Bytes of the first queued frame that are already written
+  bool m_writeError = false; // The device failed, frames are kept for the next one
+  std::unique_ptr<QSocketNotifier> m_notifier;
+  WriteStats m_stats;
+};
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::Writer::setFd(int fd)
+{
+  m_notifier.reset();
+  m_fd = fd;
+  m_writeError = false;
+  // A new device gets the complete frame
+  m_headOffset = 0;
+
+  if (m_fd < 0) { return; }
+
+  m_notifier = std::make_unique<QSocketNotifier>(m_fd, QSocketNotifier::Write);
+  m_notifier->setEnabled(false);
+  QObject::connect(m_notifier.get(), &QSocketNotifier::activated, [this](){ flush(); });
+
+  flush();
+}
+
+// -------------------------------------------------------------------------------------------------
+// Returns the number of bytes written, 0 if the device is busy or -1 on errors.
+ssize_t VirtualDevice::Writer::writeBytes(const char* data, size_t size)
+{
+  for (;;)
+  {
+    const ssize_t bytesWritten = ::write(m_fd, data, size);
+    if (bytesWritten >= 0) { return bytesWritten; }
+    if (errno == EINTR) { continue; }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) { return 0; }
+
+    logError(virtualdevice) << VirtualDevice_::tr("Error while writing to virtual device: %1")
+                               .arg(qt_error_string(errno));
+    return -1;
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::Writer::write(const input_event events[], size_t num)
+{
+  const input_event* const end = events + num;
+  const input_event* beg = events;
+
+  while (beg != end)
+  {
+    const auto syn = std::find_if(beg, end, [](const input_event& e){ return e.type == EV_SYN; });
+    const auto frameEnd = (syn == end) ? end : syn + 1;
+    const bool hasRelease = std::any_of(beg, frameEnd, [](const input_event& e) {
+      return e.type == EV_KEY && e.value == 0;
+    });
+
+    size_t bytesWritten = 0;
+    if (m_queue.empty() && m_fd >= 0 && !m_writeError)
+    { // Fast path, write directly without copying the frame
+      const auto data = reinterpret_cast<const char*>(beg);
+      const size_t size = sizeof(input_event) * (frameEnd - beg);
+      const ssize_t res = writeBytes(data, size);
+      if (res < 0) {
+        setWriteError();
+      } else {
+        bytesWritten = static_cast<size_t>(res);
+        if (bytesWritten == size) {
+          beg = frameEnd;
+          continue;
+        }
+      }
+    }
+
+    if (m_writeError && !hasRelease)
+    { // Only key releases are kept for the next device
+      drop(1, "write error");
+      beg = frameEnd;
+      continue;
+    }
+
+    Frame frame;
+    frame.events.assign(beg, frameEnd);
+    frame.hasRelease = hasRelease;
+
+    const bool wasEmpty = m_queue.empty();
+    enqueue(std::move(frame));
+    if (wasEmpty) { m_headOffset = bytesWritten; }
+    if (m_notifier && !m_writeError) { m_notifier->setEnabled(true); }
+
+    beg = frameEnd;
+  }
+}
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::Writer::enqueue(Frame&& frame)
+{
+  ++m_stats.queuedFrames;
+
+  if (m_queue.size() >= MaxQueuedFrames)
+  {
+    // Make room by dropping the oldest frame without a key release. A partially written
+    // frame is never dropped.
+    const auto first = m_queue.begin() + (m_headOffset ? 1 : 0);
+    const auto it = std::find_if(first, m_queue.end(), [](const Frame& f){ return !f.hasRelease; });
+    if (it != m_queue.end()) {
+      m_queue.erase(it);
+      drop(1, "queue full");
+    } else if (!frame.hasRelease) {
+      drop(1, "queue full");
+      return;
+    }
+    // Otherwise only key releases are queued, rather exceed the limit than risk stuck keys.
+  }
+
+  m_queue.push_back(std::move(frame));
+}
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::Writer::drop(size_t frames, const char* reason)
+{
+  // Log the first and then every 100th dropped frame
+  if (m_stats.droppedFrames % 100 == 0) {
+    logWarn(virtualdevice) << VirtualDevice_::tr("Dropping input frames on '%1' (%2, %3 dropped so far).")
+                              .arg(m_name.constData(), reason).arg(m_stats.droppedFrames + frames);
+  }
+  m_stats.droppedFrames += frames;
+}
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::Writer::setWriteError()
+{
+  m_writeError = true;
+  if (m_notifier) { m_notifier->setEnabled(false); }
+  if (m_onWriteError) { m_onWriteError(m_fd); }
+}
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::Writer::flush()
+{
+  while (!m_queue.empty() && m_fd >= 0 && !m_writeError)
+  {
+    const auto& frame = m_queue.front();
+    const size_t size = sizeof(input_event) * frame.events.size();
+    const auto data = reinterpret_cast<const char*>(frame.events.data());
+    const ssize_t res = writeBytes(data + m_headOffset, size - m_headOffset);
+
+    if (res < 0)
+    { // The device is not usable anymore. Keep the key releases for the next device, a
+      // partially written frame is written again completely then.
+      setWriteError();
+      const auto it = std::remove_if(m_queue.begin(), m_queue.end(),
+                                     [](const Frame& f){ return !f.hasRelease; });
+      const auto dropped = static_cast<size_t>(std::distance(it, m_queue.end()));
+      m_queue.erase(it, m_queue.end());
+      if (dropped) { drop(dropped, "write error"); }
+      m_headOffset = 0;
+      break;
+    }
+
+    m_headOffset += static_cast<size_t>(res);
+    if (m_headOffset < size) {
+      // Device busy or partial write, continue with the rest of the frame when writable.
+      if (m_notifier) { m_notifier->setEnabled(true); }
+      return;
+    }
+
+    m_queue.pop_front();
+    m_headOffset = 0;
+  }
+
+  if (m_notifier) { m_notifier->setEnabled(false); }
+}
+
+// -------------------------------------------------------------------------------------------------
+bool VirtualDevice::Capabilities::contains(const Capabilities& o) const
+{
+  return ((keys & o.keys) == o.keys) && ((rels & o.rels) == o.rels);
+}
+
+// -------------------------------------------------------------------------------------------------
+VirtualDevice::Capabilities& VirtualDevice::Capabilities::operator|=(const Capabilities& o)
+{
+  keys |= o.keys;
+  rels |= o.rels;
+  return *this;
+}
+
+// -------------------------------------------------------------------------------------------------
+VirtualDevice::Capabilities VirtualDevice::Capabilities::fromEvents(
+  const struct input_event input_events[], size_t num)
+{
+  Capabilities caps;
+  for (size_t i = 0; i < num; ++i)
+  {
+    const auto& ev = input_events[i];
+    if (ev.type == EV_KEY && ev.code < caps.keys.size()) { caps.keys.set(ev.code); }
+    else if (ev.type == EV_REL && ev.code < caps.rels.size()) { caps.rels.set(ev.code); }
+  }
+  return caps;
+}
+
+// -------------------------------------------------------------------------------------------------
+VirtualDevice::VirtualDevice(Token /* token */, Setup setup)
+  : m_setup(std::move(setup))
+  , m_writer(std::make_unique<Writer>(m_setup.name, [this](int fd){ replaceFailedDevice(fd); }))
 {}
 
 // -------------------------------------------------------------------------------------------------
 VirtualDevice::~VirtualDevice()
 {
-  if (m_uinpFd >= 0)
-  {
-    ioctl(m_uinpFd, UI_DEV_DESTROY);
-    ::close(m_uinpFd);
-    logDebug(virtualdevice)
-      << VirtualDevice_::tr("uinput Device Closed (%1; %2)").arg(m_userName, m_deviceName);
+  const auto& stats = m_writer->stats();
+  if (stats.queuedFrames) {
+    logDebug(virtualdevice) << VirtualDevice_::tr("uinput writer '%1': %2 frames queued, %3 dropped.")
+                               .arg(m_setup.name.constData())
+                               .arg(stats.queuedFrames).arg(stats.droppedFrames);
   }
+  discardPendingDevice();
+  destroyDevice();
 }
 
 // -------------------------------------------------------------------------------------------------
-// Setup a uinput device that can send mouse or keyboard events.
+// Check that a uinput device can be created, the device itself is created with the first
+// announced capabilities.
 std::shared_ptr<VirtualDevice> VirtualDevice::create(Type deviceType,
                                                      const char* name,
                                                      uint16_t virtualVendorId,
@@ -60,69 +392,124 @@ std::shared_ptr<VirtualDevice> VirtualDevice::create(Type deviceType,
     return std::shared_ptr<VirtualDevice>();
   }
 
-  const int fd = ::open(location, O_WRONLY | O_NDELAY);
-  if (fd < 0) {
+  if (::access(location, W_OK) != 0) {
     logWarn(virtualdevice) << VirtualDevice_::tr("Unable to open: %1").arg(location);
     logWarn(virtualdevice) << VirtualDevice_::tr("Please check if current user has write access");
     return std::shared_ptr<VirtualDevice>();
   }
 
-  struct uinput_user_dev uinp {};
-  snprintf(uinp.name, sizeof(uinp.name), "%s", name);
-  uinp.id.bustype = BUS_USB;
-  uinp.id.vendor = virtualVendorId;
-  uinp.id.product = virtualProductId;
-  uinp.id.version = virtualVersionId;
-
-  // Setup the uinput device
-  // (see all in Linux's input-event-codes.h)
-  ioctl(fd, UI_SET_EVBIT, EV_SYN);
-  ioctl(fd, UI_SET_EVBIT, EV_KEY);
-  ioctl(fd, UI_SET_EVBIT, EV_REL);
-
-  // Set all relative event code bits on virtual device
-  for (int i = 0; i < REL_CNT; ++i) {
-    ioctl(fd, UI_SET_RELBIT, i);
+  auto vdev = std::make_shared<VirtualDevice>(Token{},
+    Setup{deviceType, name, virtualVendorId, virtualProductId, virtualVersionId, location});
+
+  if (deviceType == Type::Mouse)
+  { // Minimal set of capabilities to be recognized as a pointer device
+    Capabilities caps;
+    caps.keys.set(BTN_LEFT).set(BTN_RIGHT).set(BTN_MIDDLE);
+    caps.rels.set(REL_X).set(REL_Y);
+    vdev->m_capabilities = caps;
   }
 
-  // Thank's to Matthias Blümel / https://github.com/Blaimi
-  // for the detailed investigation on the uinput issue on newer
-  // Linux distributions.
-  // See https://github.com/jahnf/Projecteur/issues/175#issuecomment-1432112896
+  logDebug(virtualdevice) << VirtualDevice_::tr("uinput device '%1' will be created on demand.")
+                             .arg(name);
+  return vdev;
+}
 
-  if (deviceType == Type::Mouse) {
-    // Set key code bits for a virtual mouse
-    for (int i = BTN_MISC; i < KEY_OK; ++i) {
-      ioctl(fd, UI_SET_KEYBIT, i);
-    }
-  } else if (deviceType == Type::Keyboard) {
-    // Set key code bits for a virtual keyboard
-    for (int i = 1; i < BTN_MISC; ++i) {
-      ioctl(fd, UI_SET_KEYBIT, i);
-    }
-    for (int i = KEY_OK; i < KEY_MACRO1; ++i) {
-      ioctl(fd, UI_SET_KEYBIT, i);
-    }
-    // will set key bits from i = KEY_MACRO1 to i < KEY_CNT also work?
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::addCapabilities(const Capabilities& capabilities)
+{
+  if (m_capabilities.contains(capabilities)) { return; }
+
+  m_capabilities |= capabilities;
+  m_creationFailed = false;
+  updateDevice();
+}
+
+// -------------------------------------------------------------------------------------------------
+// Create a uinput device with all capabilities known so far, if the current device is missing
+// any of them. The new device is only used after udev and libinput had time to open it, until
+// then events are still written to the current device, or queued if there is none yet.
+void VirtualDevice::updateDevice()
+{
+  if (m_capabilities.empty() || m_creationFailed) { return; }
+  if (m_uinpFd >= 0 && m_deviceCapabilities.contains(m_capabilities)) { return; }
+  if (m_pendingDevice.fd >= 0 && m_pendingDevice.caps.contains(m_capabilities)) { return; }
+
+  // Nothing was written to a pending device yet, it can be replaced right away.
+  discardPendingDevice();
+
+  const auto dev = createUinputDevice(m_setup, m_capabilities);
+  if (dev.fd < 0) {
+    m_creationFailed = true;
+    return;
   }
 
-  // Create input device into input sub-system
-  const auto bytesWritten = write(fd, &uinp, sizeof(uinp));
-  if ((bytesWritten != sizeof(uinp)) || (ioctl(fd, UI_DEV_CREATE)))
+  m_pendingDevice = PendingDevice{dev.fd, dev.sysName, m_capabilities};
+  const auto id = ++m_pendingDeviceId;
+  QTimer::singleShot(DeviceSettleTimeMs, QCoreApplication::instance(),
+                     [weakSelf = std::weak_ptr<VirtualDevice>(shared_from_this()), id]()
   {
-    ::close(fd);
-    logWarn(virtualdevice) << VirtualDevice_::tr("Unable to create Virtual (UINPUT) device.");
-    return std::unique_ptr<VirtualDevice>();
-  }
+    const auto self = weakSelf.lock();
+    if (!self || self->m_pendingDeviceId != id || self->m_pendingDevice.fd < 0) {
+      return; // Discarded or replaced in the meantime
+    }
+    const auto pending = std::move(self->m_pendingDevice);
+    self->m_pendingDevice = PendingDevice();
+    self->attachDevice(pending.fd, pending.sysName, pending.caps);
+  });
+}
 
-  // Log the device name
-  char sysfs_device_name[16]{};
-  ioctl(fd, UI_GET_SYSNAME(sizeof(sysfs_device_name)), sysfs_device_name);
-  logInfo(virtualdevice) << VirtualDevice_::tr("Created uinput device: %1")
-                            .arg(QString("%1; /sys/devices/virtual/input/%2")
-                              .arg(name, sysfs_device_name));
+// -------------------------------------------------------------------------------------------------
+// The device with fd does not accept events anymore. Create a new one, until it is attached only
+// frames with key releases are kept by the writer.
+void VirtualDevice::replaceFailedDevice(int fd)
+{
+  // Deferred, the writer reports the error while writing.
+  QTimer::singleShot(0, QCoreApplication::instance(),
+                     [weakSelf = std::weak_ptr<VirtualDevice>(shared_from_this()), fd]()
+  {
+    const auto self = weakSelf.lock();
+    if (!self || self->m_uinpFd != fd || fd < 0) {
+      return; // Replaced in the meantime
+    }
+    logWarn(virtualdevice) << VirtualDevice_::tr("uinput device '%1' failed, creating a new one.")
+                              .arg(self->m_setup.name.constData());
+    self->m_deviceCapabilities = Capabilities();
+    self->m_creationFailed = false;
+    self->updateDevice();
+  });
+}
 
-  return std::make_shared<VirtualDevice>(Token{}, fd, name, sysfs_device_name);
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::discardPendingDevice()
+{
+  if (m_pendingDevice.fd < 0) { return; }
+
+  destroyUinputDevice(m_pendingDevice.fd);
+  m_pendingDevice = PendingDevice();
+}
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::attachDevice(int fd, const QString& sysName, const Capabilities& caps)
+{
+  destroyDevice();
+  m_uinpFd = fd;
+  m_deviceName = sysName;
+  m_deviceCapabilities = caps;
+  // Also writes frames that are still queued for the previous device
+  m_writer->setFd(m_uinpFd);
+}
+
+// -------------------------------------------------------------------------------------------------
+void VirtualDevice::destroyDevice()
+{
+  if (m_uinpFd < 0) { return; }
+
+  // Destroying the device also releases all keys that are still pressed on it.
+  m_writer->setFd(-1);
+  destroyUinputDevice(m_uinpFd);
+  m_uinpFd = -1;
+  logDebug(virtualdevice)
+    << VirtualDevice_::tr("uinput Device Closed (%1; %2)").arg(m_setup.name.constData(), m_deviceName);
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -130,12 +517,30 @@ void VirtualDevice::emitEvents(const struct input_event input_events[], size_t n
 {
   if (!num) { return; }
 
-  if (const ssize_t sz = sizeof(input_event) * num) {
-    const auto bytesWritten = write(m_uinpFd, input_events, sz);
-    if (bytesWritten != sz) {
-      logError(virtualdevice) << VirtualDevice_::tr("Error while writing to virtual device.");
-    }
+  const auto required = Capabilities::fromEvents(input_events, num);
+  if (!m_capabilities.contains(required))
+  {
+    // The kernel filters codes that were not announced before. Write the events anyway, the
+    // device is replaced by one with the additional codes in the background.
+    logDebug(virtualdevice) << VirtualDevice_::tr("Adding unannounced event codes to '%1'.")
+                               .arg(m_setup.name.constData());
+    addCapabilities(required);
   }
+  else if (m_uinpFd < 0) {
+    updateDevice();
+  }
+
+  // Without any device, events are only queued while one is being created.
+  if (m_uinpFd < 0 && m_pendingDevice.fd < 0) { return; }
+  m_writer->write(input_events, num);
+}
+
+// -------------------------------------------------------------------------------------------------
+VirtualDevice::WriteStats VirtualDevice::writeStats() const
+{
+  auto stats = m_writer->stats();
+  stats.pendingFrames = m_writer->pendingFrames();
+  return stats;
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -7,20 +7,25 @@
 
 # pragma once
 
+#include <QByteArray>
 #include <QString>
 
+#include <bitset>
 #include <cstdint>
 #include <memory>
 #include <vector>
 
-/// Device that can act as virtual keyboard or mouse
-class VirtualDevice
+/// Device that can act as virtual keyboard or mouse.
+///
+/// The uinput device is created when capabilities (key and relative axis codes) are announced,
+/// e.g. when a device is grabbed or the input mapping is configured, and only advertises those
+/// instead of every possible code. If capabilities are added later, a new device is created and
+/// replaces the current one once it is set up, events are written to the current one until then.
+/// A device that fails on writing is replaced the same way.
+class VirtualDevice : public std::enable_shared_from_this<VirtualDevice>
 {
 private:
   struct Token;
-  int m_uinpFd = -1;
-  QString m_userName;
-  QString m_deviceName;
 
 public:
   enum class Type {
@@ -28,7 +33,22 @@ public:
     Keyboard
   };
 
-  /// Return a VirtualDevice shared_ptr or an empty shared_ptr if the creation fails.
+  /// Key and relative axis codes a virtual device advertises.
+  struct Capabilities
+  {
+    std::bitset<0x300> keys; ///< KEY_CNT of linux/input-event-codes.h
+    std::bitset<0x10> rels;  ///< REL_CNT of linux/input-event-codes.h
+
+    bool empty() const { return keys.none() && rels.none(); }
+    bool contains(const Capabilities& o) const;
+    Capabilities& operator|=(const Capabilities& o);
+    bool operator==(const Capabilities& o) const { return keys == o.keys && rels == o.rels; }
+
+    /// Capabilities of input events, EV_SYN and other event types are ignored.
+    static Capabilities fromEvents(const struct input_event[], size_t num);
+  };
+
+  /// Return a VirtualDevice shared_ptr or an empty shared_ptr if uinput is not available.
   static std::shared_ptr<VirtualDevice> create(Type deviceType,
                                                const char* name = "Projecteur_input_device",
                                                uint16_t virtualVendorId = 0xfeed,
@@ -36,9 +56,60 @@ public:
                                                uint16_t virtualVersionId = 1,
                                                const char* location = "/dev/uinput");
 
-  VirtualDevice(Token, int fd, const char* name, const char* sysfs_name);
+  struct Setup
+  {
+    Type type;
+    QByteArray name;
+    uint16_t vendorId;
+    uint16_t productId;
+    uint16_t versionId;
+    QByteArray location;
+  };
+
+  VirtualDevice(Token, Setup setup);
   ~VirtualDevice();
 
+  const Capabilities& capabilities() const { return m_capabilities; }
+  /// Add capabilities and create the uinput device, or a replacement with all capabilities.
+  void addCapabilities(const Capabilities& capabilities);
+
+  /// Emit events; frames (events up to and including EV_SYN) that cannot be written right away
+  /// are queued and written as soon as the device accepts data again.
   void emitEvents(const struct input_event[], size_t num);
   void emitEvents(const std::vector<struct input_event>& events);
+
+  /// Counters of the uinput writer.
+  struct WriteStats
+  {
+    uint64_t queuedFrames = 0;  ///< Frames that could not be written immediately
+    uint64_t droppedFrames = 0; ///< Frames dropped because the queue was full or on write errors
+    size_t pendingFrames = 0;   ///< Frames currently waiting in the queue
+  };
+  WriteStats writeStats() const;
+
+private:
+  struct Writer;
+
+  void updateDevice();
+  void discardPendingDevice();
+  void replaceFailedDevice(int fd);
+  void attachDevice(int fd, const QString& sysName, const Capabilities& caps);
+  void destroyDevice();
+
+  struct PendingDevice
+  {
+    int fd = -1;
+    QString sysName;
+    Capabilities caps;
+  };
+
+  const Setup m_setup;
+  Capabilities m_capabilities;
+  Capabilities m_deviceCapabilities; // capabilities of the current uinput device
+  int m_uinpFd = -1;
+  QString m_deviceName;
+  std::unique_ptr<Writer> m_writer;
+  PendingDevice m_pendingDevice; // created, but not yet used instead of the current device
+  unsigned m_pendingDeviceId = 0;
+  bool m_creationFailed = false;
 };